@@ -0,0 +1,152 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Counts heap allocations made by merror macros when they fail and enforces a
+// budget for each scenario. If a change makes the failure path allocate more,
+// this test fails. If it makes it allocate less, lower the budget.
+//
+// Every scenario is run once before counting, so that one-time allocations
+// (per-thread scratch buffers, per-site state) aren't counted.
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/domain/no_alloc.h"
+#include "merror/macros.h"
+
+namespace {
+
+thread_local bool counting = false;
+thread_local int allocations = 0;
+
+void* Allocate(size_t n) {
+  if (counting) ++allocations;
+  if (void* p = malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+
+}  // namespace
+
+void* operator new(size_t n) { return Allocate(n); }
+void* operator new[](size_t n) { return Allocate(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace merror {
+namespace {
+
+constexpr auto MErrorDomain =
+    Default().DefaultErrorCode(absl::StatusCode::kUnknown);
+
+// Returns the number of allocations made by `f()` after a warm-up call.
+template <class F>
+int CountAllocations(F f) {
+  f();
+  allocations = 0;
+  counting = true;
+  f();
+  counting = false;
+  return allocations;
+}
+
+// Messages are long enough to defeat the small string optimization.
+absl::Status VerifyBool(bool x) {
+  MVERIFY(x);
+  return absl::OkStatus();
+}
+
+absl::Status VerifyRelational(int x) {
+  MVERIFY(x > 0);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<int> TryWithDescription(absl::StatusOr<int> x) {
+  return MTRY(x, _ << "Cannot process item " << 42);
+}
+
+absl::Status VerifyWithPolicyDescription(int x) {
+  const auto MErrorDomain =
+      merror::MErrorDomain << "While processing item " << 42 << " of " << 100;
+  MVERIFY(x > 0);
+  return absl::OkStatus();
+}
+
+absl::Status VerifyLogged(int x) {
+  MVERIFY(x > 0).CerrLog() << "While processing item " << 42;
+  return absl::OkStatus();
+}
+
+ErrorRing ring(16);
+
+absl::StatusCode VerifyNoAlloc(int x) {
+  const auto MErrorDomain = NoAlloc().LogTo(&ring);
+  MVERIFY(x > 0).ErrorCode(absl::StatusCode::kInvalidArgument)
+      << "While processing item " << 42 << " of " << 100u;
+  return absl::StatusCode::kOk;
+}
+
+absl::StatusCode TryNoAlloc(absl::StatusOr<int> x) {
+  const auto MErrorDomain = NoAlloc().LogTo(&ring);
+  return MTRY(x, _ << "Cannot process item " << 42) > 0
+             ? absl::StatusCode::kOk
+             : absl::StatusCode::kInternal;
+}
+
+TEST(Allocations, VerifyBool) {
+  // The Status and its message.
+  EXPECT_LE(CountAllocations([] { VerifyBool(false).IgnoreError(); }), 2);
+}
+
+TEST(Allocations, VerifyRelational) {
+  EXPECT_LE(CountAllocations([] { VerifyRelational(0).IgnoreError(); }), 2);
+}
+
+TEST(Allocations, TryWithDescription) {
+  absl::Status culprit = absl::NotFoundError("Item is missing");
+  EXPECT_LE(CountAllocations(
+                [&] { TryWithDescription(culprit).IgnoreError(); }),
+            2);
+}
+
+TEST(Allocations, VerifyWithPolicyDescription) {
+  // The policy description is formatted into a reusable buffer and copied
+  // once. Then the Status and its message.
+  EXPECT_LE(
+      CountAllocations([] { VerifyWithPolicyDescription(0).IgnoreError(); }),
+      3);
+}
+
+TEST(Allocations, VerifyLogged) {
+  // Log messages are formatted into a reusable buffer.
+  EXPECT_LE(CountAllocations([] { VerifyLogged(0).IgnoreError(); }), 2);
+}
+
+TEST(Allocations, NoAlloc) {
+  EXPECT_EQ(0, CountAllocations([] { VerifyNoAlloc(0); }));
+  absl::StatusOr<int> culprit = absl::NotFoundError("Item is missing");
+  EXPECT_EQ(0, CountAllocations([&] { TryNoAlloc(culprit); }));
+}
+
+}  // namespace
+}  // namespace merror
@@ -0,0 +1,202 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `AsyncTee`. This error domain extension adds method `AsyncTee()` to
+// the policy and the builder. It's like `Tee()` (see
+// //util/merror/domain/tee.h), except that the sink isn't called on the thread
+// that has detected the error. When `AsyncTee(executor, sink)` is called, a
+// pointer to the executor and the sink get stored in the policy/builder. Later,
+// if an error is detected, it gets constructed, moved into a task together
+// with a copy of the sink and posted to the executor before returning.
+//
+//   merror::ThreadPool pool(/*num_threads=*/1, /*max_queue_size=*/1000);
+//
+//   Status Handle(const Request& req) {
+//     const auto MErrorDomain = merror::Default()
+//                                   .With(merror::AsyncTee())
+//                                   .AsyncTee(&pool, [](absl::Status s) {
+//                                     PublishToMetrics(s);
+//                                   });
+//     MTRY(CallBackend(req));
+//     ...
+//   }
+//
+// The sink must be a function pointer or a copyable functor with exactly one
+// parameter. The parameter type determines the type of the error that is
+// passed to the sink, so generic lambdas aren't supported. The error must be
+// copyable.
+//
+// An executor is any object with method `Post(std::function<void()> task)`.
+// The return value of `Post()` is ignored. The executor must outlive the
+// policy/builder that refers to it. `ThreadPool` is an executor with a bounded
+// queue: tasks that don't fit are dropped and counted.
+//
+// When `AsyncTee()` is called multiple times, all sinks are stored. In the case
+// of an error the tasks are posted in the same order as the sinks were passed.
+//
+// `NoAsyncTee()` removes all previously stored sinks from the policy/builder.
+
+#ifndef MERROR_5EDA97_DOMAIN_ASYNC_TEE_H_
+#define MERROR_5EDA97_DOMAIN_ASYNC_TEE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "merror/domain/base.h"
+#include "merror/domain/defer.h"
+#include "merror/domain/observer.h"
+#include "merror/domain/return.h"
+#include "merror/types.h"
+
+namespace merror {
+
+// Executor that runs tasks on a fixed number of threads. See comments at the
+// top of the file.
+class ThreadPool {
+ public:
+  // Starts `num_threads` threads. At most `max_queue_size` tasks may be waiting
+  // to be run; tasks posted when the queue is full are dropped.
+  ThreadPool(int num_threads, size_t max_queue_size);
+
+  // Runs the tasks that are still in the queue and joins the threads.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Enqueues the task. Returns false if it has been dropped.
+  bool Post(std::function<void()> task);
+
+  // The number of dropped tasks.
+  uint64_t dropped() const;
+
+ private:
+  void Run();
+
+  const size_t max_queue_size_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> queue_;
+  uint64_t dropped_ = 0;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+namespace internal_async_tee {
+
+struct AsyncTeeAnnotation {};
+
+// The parameter type of a sink.
+template <class F>
+struct SinkArg : SinkArg<decltype(&F::operator())> {};
+
+template <class R, class T>
+struct SinkArg<R (*)(T)> {
+  using type = std::decay_t<T>;
+};
+
+template <class R, class C, class T>
+struct SinkArg<R (C::*)(T)> : SinkArg<R (*)(T)> {};
+
+template <class R, class C, class T>
+struct SinkArg<R (C::*)(T) const> : SinkArg<R (*)(T)> {};
+
+template <class Executor, class Sink>
+struct Target {
+  Executor* executor;
+  Sink sink;
+};
+
+template <size_t I>
+struct PostAll {
+  template <class Builder, class... Targets>
+  void operator()(const Builder& builder,
+                  std::tuple<Targets...>&& targets) const {
+    auto&& target = std::get<I - 1>(std::move(targets));
+    using Sink = std::decay_t<decltype(target.sink)>;
+    using Error = typename SinkArg<Sink>::type;
+    target.executor->Post(
+        [sink = std::move(target.sink),
+         error = builder.MakeError(ResultType<Error>(),
+                                   builder.context().culprit)]() mutable {
+          sink(std::move(error));
+        });
+    PostAll<I - 1>()(builder, std::move(targets));
+  }
+};
+
+template <>
+struct PostAll<0> {
+  template <class Builder, class... Targets>
+  void operator()(const Builder&, std::tuple<Targets...>&&) const {}
+};
+
+template <class Base>
+struct Policy : Base {
+  template <class Executor, class Sink>
+  constexpr auto AsyncTee(Executor* executor, Sink sink) const {
+    return AddAnnotation<AsyncTeeAnnotation>(
+        *this, Target<Executor, Sink>{executor, std::move(sink)});
+  }
+
+  template <class X = void>
+  constexpr auto NoAsyncTee() const
+      -> decltype(RemoveAnnotations<AsyncTeeAnnotation>(Defer<X>(*this))) {
+    return RemoveAnnotations<AsyncTeeAnnotation>(*this);
+  }
+};
+
+template <class Base>
+struct Builder : Observer<Base> {
+  template <class Executor, class Sink>
+  auto AsyncTee(Executor* executor, Sink sink) && {
+    return AddAnnotation<AsyncTeeAnnotation>(
+        std::move(*this), Target<Executor, Sink>{executor, std::move(sink)});
+  }
+
+  template <class X = void>
+  auto NoAsyncTee() && -> decltype(RemoveAnnotations<AsyncTeeAnnotation>(
+      std::move(Defer<X>(*this)))) {
+    return RemoveAnnotations<AsyncTeeAnnotation>(std::move(*this));
+  }
+
+  template <class RetVal>
+  void ObserveRetVal(const RetVal& ret_val) {
+    auto targets = GetAnnotations<AsyncTeeAnnotation>(std::move(*this));
+    PostAll<std::tuple_size<decltype(targets)>::value>()(this->derived(),
+                                                         std::move(targets));
+    Observer<Base>::ObserveRetVal(ret_val);
+  }
+};
+
+}  // namespace internal_async_tee
+
+// Error domain extension that adds `AsyncTee()` to the policy and the builder.
+// See comments at the top of the file for details.
+using AsyncTee =
+    Domain<internal_async_tee::Policy, internal_async_tee::Builder>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_ASYNC_TEE_H_
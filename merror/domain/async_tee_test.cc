@@ -0,0 +1,137 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/async_tee.h"
+
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::absl::StatusCode;
+using ::testing::ElementsAre;
+
+// Executor that stores tasks until they are run explicitly.
+struct ManualExecutor {
+  void Post(std::function<void()> task) { tasks.push_back(std::move(task)); }
+  void RunAll() {
+    for (auto& task : tasks) task();
+    tasks.clear();
+  }
+  std::vector<std::function<void()>> tasks;
+};
+
+constexpr auto MErrorDomain =
+    Default().With(AsyncTee()).DefaultErrorCode(StatusCode::kUnknown);
+
+TEST(AsyncTee, Policy) {
+  ManualExecutor executor;
+  std::vector<StatusCode> codes;
+  auto F = [&](bool val) -> absl::Status {
+    const auto MErrorDomain = merror::MErrorDomain.AsyncTee(
+        &executor, [&](absl::Status s) { codes.push_back(s.code()); });
+    MVERIFY(val).ErrorCode(StatusCode::kNotFound);
+    return absl::OkStatus();
+  };
+  EXPECT_TRUE(F(true).ok());
+  EXPECT_TRUE(executor.tasks.empty());
+  EXPECT_EQ(StatusCode::kNotFound, F(false).code());
+  // The sink hasn't been called yet.
+  EXPECT_TRUE(codes.empty());
+  executor.RunAll();
+  EXPECT_THAT(codes, ElementsAre(StatusCode::kNotFound));
+}
+
+TEST(AsyncTee, MultipleSinks) {
+  ManualExecutor executor;
+  std::vector<std::string> calls;
+  auto F = [&](bool val) {
+    MVERIFY(val)
+        .AsyncTee(&executor, [&](absl::Status) { calls.push_back("status"); })
+        .AsyncTee(&executor, [&](bool b) {
+          EXPECT_FALSE(b);
+          calls.push_back("bool");
+        })
+        .Return<bool>();
+    return true;
+  };
+  EXPECT_FALSE(F(false));
+  executor.RunAll();
+  EXPECT_THAT(calls, ElementsAre("status", "bool"));
+}
+
+TEST(AsyncTee, NoAsyncTee) {
+  ManualExecutor executor;
+  auto F = [&](bool val) -> absl::Status {
+    const auto MErrorDomain =
+        merror::MErrorDomain.AsyncTee(&executor, [](absl::Status) {})
+            .NoAsyncTee();
+    MVERIFY(val);
+    return absl::OkStatus();
+  };
+  EXPECT_FALSE(F(false).ok());
+  EXPECT_TRUE(executor.tasks.empty());
+}
+
+TEST(AsyncTee, ThreadPool) {
+  std::thread::id caller = std::this_thread::get_id();
+  std::promise<std::thread::id> sink_thread;
+  {
+    ThreadPool pool(1, 10);
+    auto F = [&]() -> absl::Status {
+      MVERIFY(false).AsyncTee(&pool, [&](absl::Status s) {
+        EXPECT_EQ(StatusCode::kUnknown, s.code());
+        sink_thread.set_value(std::this_thread::get_id());
+      });
+      return absl::OkStatus();
+    };
+    EXPECT_FALSE(F().ok());
+  }
+  EXPECT_NE(caller, sink_thread.get_future().get());
+}
+
+TEST(ThreadPool, DropsWhenFull) {
+  std::promise<void> unblock;
+  std::shared_future<void> blocked = unblock.get_future().share();
+  std::promise<void> started;
+  int ran = 0;
+  {
+    ThreadPool pool(1, 1);
+    EXPECT_TRUE(pool.Post([&] {
+      started.set_value();
+      blocked.wait();
+    }));
+    started.get_future().wait();
+    EXPECT_TRUE(pool.Post([&] { ++ran; }));
+    EXPECT_FALSE(pool.Post([&] { ++ran; }));
+    EXPECT_FALSE(pool.Post([&] { ++ran; }));
+    EXPECT_EQ(2, pool.dropped());
+    unblock.set_value();
+  }
+  // The queued task has run before the pool has been destroyed.
+  EXPECT_EQ(1, ran);
+}
+
+}  // namespace
+}  // namespace merror
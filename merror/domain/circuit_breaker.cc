@@ -0,0 +1,114 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "merror/domain/circuit_breaker.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+
+namespace merror {
+namespace internal_circuit_breaker {
+
+namespace {
+
+int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+bool Reject(State& state, int64_t open_until, const Config& config) {
+  int64_t now = Now();
+  if (now < open_until) return true;
+  // The cooldown is over. The thread that moves `open_until` forward gets to
+  // probe; the others keep failing until the probe completes or the next
+  // cooldown is over.
+  if (!state.open_until.compare_exchange_strong(
+          open_until, now + absl::ToInt64Nanoseconds(config.cooldown),
+          std::memory_order_relaxed)) {
+    return true;
+  }
+  probe = &state;
+  return false;
+}
+
+void RecordError(State& state, const Config& config) {
+  int64_t now = Now();
+  int64_t cooldown = absl::ToInt64Nanoseconds(config.cooldown);
+  if (state.open_until.load(std::memory_order_relaxed) != 0) {
+    // Only the outcome of the probe matters while the breaker is open.
+    if (probe == &state) {
+      probe = nullptr;
+      state.open_until.store(now + cooldown, std::memory_order_relaxed);
+    }
+    return;
+  }
+  int64_t start = state.window_start.load(std::memory_order_relaxed);
+  int errors;
+  int calls;
+  if (now - start >= absl::ToInt64Nanoseconds(config.window) &&
+      state.window_start.compare_exchange_strong(start, now,
+                                                 std::memory_order_relaxed)) {
+    // This thread has started a new window. Calls that other threads count
+    // concurrently may get lost, which is fine.
+    errors = 1;
+    calls = 1;
+    state.errors.store(errors, std::memory_order_relaxed);
+    state.successes.store(0, std::memory_order_relaxed);
+  } else {
+    errors = state.errors.fetch_add(1, std::memory_order_relaxed) + 1;
+    calls = errors + state.successes.load(std::memory_order_relaxed);
+  }
+  if (calls >= config.min_calls && errors >= config.error_rate * calls) {
+    state.open_until.store(now + cooldown, std::memory_order_relaxed);
+  }
+}
+
+void RecordOpenSuccess(State& state) {
+  // Calls that were let through before the breaker opened don't close it.
+  if (probe != &state) return;
+  probe = nullptr;
+  state.errors.store(0, std::memory_order_relaxed);
+  state.successes.store(0, std::memory_order_relaxed);
+  state.window_start.store(Now(), std::memory_order_relaxed);
+  state.open_until.store(0, std::memory_order_relaxed);
+}
+
+const absl::Status& Culprit(State& state, const char* file, int line) {
+  const absl::Status* culprit = state.culprit.load(std::memory_order_acquire);
+  if (culprit) return *culprit;
+  auto* status = new absl::Status(
+      absl::StatusCode::kUnavailable,
+      absl::StrCat(file, ":", line, ": Circuit breaker is open"));
+  if (state.culprit.compare_exchange_strong(culprit, status,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+    return *status;
+  }
+  // Another thread has won the race.
+  delete status;
+  return *culprit;
+}
+
+}  // namespace internal_circuit_breaker
+}  // namespace merror
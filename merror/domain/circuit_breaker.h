@@ -0,0 +1,176 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `CircuitBreaker`. This error domain extension adds method
+// `CircuitBreaker(error_rate, min_calls, window, cooldown)` to the policy. When
+// it's called, every `MTRY()` site that uses the policy gets its own circuit
+// breaker. Once the fraction of failed calls at the site within `window`
+// reaches `error_rate`, and there have been at least `min_calls` calls, the
+// breaker opens: for the next `cooldown`, `MTRY()` at that site fails
+// immediately, without evaluating its argument.
+//
+//   const auto MErrorDomain =
+//       merror::Default()
+//           .With(merror::CircuitBreaker())
+//           .CircuitBreaker(/*error_rate=*/0.5, /*min_calls=*/20,
+//                           /*window=*/absl::Seconds(1),
+//                           /*cooldown=*/absl::Seconds(5));
+//
+//   Status Handle(const Request& req) {
+//     // If the backend keeps failing, stop calling it for a while.
+//     Response resp = MTRY(CallBackend(req));
+//     ...
+//   }
+//
+// A window starts with the first error after the previous window has ended.
+//
+// After the cooldown, a single call is let through as a probe while others
+// keep failing. If it succeeds, the breaker closes. If it fails, the breaker
+// stays open for another cooldown. Only the probe decides: calls that were let
+// through before the breaker opened and finish while it's open are ignored.
+//
+// A short-circuited `MTRY()` builds its error as usual, with the builder patch,
+// annotations and observers. The culprit is a cached `absl::Status` with code
+// `UNAVAILABLE`, so the domain must be able to make errors from it. Builder
+// methods such as `ErrorCode()` override the code.
+//
+// A site is identified by the file name and the line number, so several
+// `MTRY()` on the same line share a breaker. Only `MTRY()` and `MCO_TRY()` are
+// affected; `MVERIFY()` is meant for cheap checks.
+//
+// The state of the breakers is lock-free. While a breaker is closed, the
+// overhead of a successful `MTRY()` is two relaxed atomic loads and a relaxed
+// atomic increment. Errors take a few more atomic operations.
+//
+// `NoCircuitBreaker()` removes the breaker from the policy.
+
+#ifndef MERROR_5EDA97_DOMAIN_CIRCUIT_BREAKER_H_
+#define MERROR_5EDA97_DOMAIN_CIRCUIT_BREAKER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "merror/domain/base.h"
+#include "merror/domain/defer.h"
+
+namespace merror {
+
+namespace internal_circuit_breaker {
+
+struct CircuitBreakerAnnotation {};
+
+struct Config {
+  double error_rate;
+  int min_calls;
+  absl::Duration window;
+  absl::Duration cooldown;
+};
+
+// The state of the breaker at a single site.
+struct State {
+  // The start of the current window in nanoseconds of `steady_clock`.
+  std::atomic<int64_t> window_start{0};
+  // The number of failed and successful calls in the current window.
+  std::atomic<int> errors{0};
+  std::atomic<int> successes{0};
+  // Zero if the breaker is closed. Otherwise the time when the next probe is
+  // allowed.
+  std::atomic<int64_t> open_until{0};
+  // The culprit of short-circuited `MTRY()`. Built on first use.
+  std::atomic<const absl::Status*> culprit{nullptr};
+};
+
+template <class Site>
+inline State state;
+
+// The breaker whose probe the current thread is making, if any.
+inline thread_local State* probe = nullptr;
+
+// Called when the breaker isn't closed. `open_until` is the value of
+// `state.open_until`. Returns false if the call should proceed as a probe.
+bool Reject(State& state, int64_t open_until, const Config& config);
+
+void RecordError(State& state, const Config& config);
+
+// Called on success while the breaker isn't closed. Closes it if the call was
+// the probe.
+void RecordOpenSuccess(State& state);
+
+const absl::Status& Culprit(State& state, const char* file, int line);
+
+template <class Base>
+struct Policy : Base {
+  constexpr auto CircuitBreaker(double error_rate, int min_calls,
+                                absl::Duration window,
+                                absl::Duration cooldown) const {
+    return AddAnnotation<CircuitBreakerAnnotation>(
+        *this, Config{error_rate, min_calls, window, cooldown});
+  }
+
+  template <class X = void>
+  constexpr auto NoCircuitBreaker() const
+      -> decltype(RemoveAnnotations<CircuitBreakerAnnotation>(
+          Defer<X>(*this))) {
+    return RemoveAnnotations<CircuitBreakerAnnotation>(*this);
+  }
+
+  template <class Site>
+  ABSL_ATTRIBUTE_ALWAYS_INLINE bool ShouldShortCircuit(Site) const {
+    if constexpr (HasAnnotation<CircuitBreakerAnnotation, Base>()) {
+      State& s = state<Site>;
+      int64_t open_until = s.open_until.load(std::memory_order_relaxed);
+      if (ABSL_PREDICT_TRUE(open_until == 0)) return false;
+      return Reject(s, open_until,
+                    GetAnnotation<CircuitBreakerAnnotation>(*this));
+    } else {
+      return false;
+    }
+  }
+
+  template <class Site>
+  const absl::Status& ShortCircuitCulprit(Site site) const {
+    return Culprit(state<Site>, site.file, site.line);
+  }
+
+  template <class Site>
+  ABSL_ATTRIBUTE_ALWAYS_INLINE void ObserveOutcome(Site, bool error) const {
+    if constexpr (HasAnnotation<CircuitBreakerAnnotation, Base>()) {
+      State& s = state<Site>;
+      if (ABSL_PREDICT_FALSE(error)) {
+        RecordError(s, GetAnnotation<CircuitBreakerAnnotation>(*this));
+      } else {
+        s.successes.fetch_add(1, std::memory_order_relaxed);
+        if (ABSL_PREDICT_FALSE(s.open_until.load(std::memory_order_relaxed) !=
+                               0)) {
+          RecordOpenSuccess(s);
+        }
+      }
+    }
+  }
+};
+
+}  // namespace internal_circuit_breaker
+
+// Error domain extension that adds `CircuitBreaker()` to the policy. See
+// comments at the top of the file for details.
+using CircuitBreaker = Policy<internal_circuit_breaker::Policy>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_CIRCUIT_BREAKER_H_
@@ -0,0 +1,195 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/circuit_breaker.h"
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::absl::StatusCode;
+
+constexpr auto MErrorDomain = Default()
+                                  .DefaultErrorCode(StatusCode::kUnknown)
+                                  .With(CircuitBreaker())
+                                  .CircuitBreaker(0.5, 4,
+                                                  absl::InfiniteDuration(),
+                                                  absl::Hours(1));
+
+// Counts calls, so that the tests can tell whether the argument of `MTRY()` has
+// been evaluated.
+struct Backend {
+  absl::StatusOr<int> Call(absl::StatusOr<int> x) {
+    ++calls;
+    return x;
+  }
+  int calls = 0;
+};
+
+absl::StatusOr<int> Open(Backend& b, absl::StatusOr<int> x) {
+  return MTRY(b.Call(x)) + 1;
+}
+
+absl::StatusOr<int> Other(Backend& b, absl::StatusOr<int> x) {
+  return MTRY(b.Call(x)) + 1;
+}
+
+absl::StatusOr<int> Patched(Backend& b, absl::StatusOr<int> x) {
+  return MTRY(b.Call(x), ErrorCode(StatusCode::kAborted)) + 1;
+}
+
+absl::StatusOr<int> Probe(Backend& b, absl::StatusOr<int> x) {
+  constexpr auto MErrorDomain = merror::MErrorDomain.CircuitBreaker(
+      0.5, 2, absl::InfiniteDuration(), absl::ZeroDuration());
+  return MTRY(b.Call(x)) + 1;
+}
+
+absl::StatusOr<int> Window(Backend& b, absl::StatusOr<int> x) {
+  constexpr auto MErrorDomain = merror::MErrorDomain.CircuitBreaker(
+      0.5, 2, absl::ZeroDuration(), absl::Hours(1));
+  return MTRY(b.Call(x)) + 1;
+}
+
+absl::StatusOr<int> Rate(Backend& b, absl::StatusOr<int> x) {
+  return MTRY(b.Call(x)) + 1;
+}
+
+absl::StatusOr<int> Few(Backend& b, absl::StatusOr<int> x) {
+  return MTRY(b.Call(x)) + 1;
+}
+
+// Fails `n` times through the same `MTRY()` while evaluating its argument, and
+// then succeeds.
+absl::StatusOr<int> InFlight(Backend& b, int n) {
+  absl::StatusOr<int> x = 1;
+  if (n < 0) x = absl::NotFoundError("");
+  return MTRY([&] {
+           for (int i = 0; i < n; ++i) InFlight(b, -1).IgnoreError();
+           return b.Call(x);
+         }()) +
+         1;
+}
+
+absl::StatusOr<int> Disabled(Backend& b, absl::StatusOr<int> x) {
+  constexpr auto MErrorDomain = merror::MErrorDomain.NoCircuitBreaker();
+  return MTRY(b.Call(x)) + 1;
+}
+
+TEST(CircuitBreaker, Opens) {
+  Backend b;
+  EXPECT_EQ(2, *Open(b, 1));
+  for (int i = 0; i != 3; ++i) {
+    EXPECT_EQ(StatusCode::kNotFound,
+              Open(b, absl::NotFoundError("")).status().code());
+  }
+  EXPECT_EQ(4, b.calls);
+  absl::Status s = Open(b, 1).status();
+  EXPECT_EQ(StatusCode::kUnavailable, s.code());
+  EXPECT_THAT(std::string(s.message()),
+              ::testing::HasSubstr("Circuit breaker is open"));
+  EXPECT_EQ(StatusCode::kUnavailable, Open(b, 1).status().code());
+  EXPECT_EQ(4, b.calls);
+  // Other sites aren't affected.
+  EXPECT_EQ(2, *Other(b, 1));
+  EXPECT_EQ(5, b.calls);
+}
+
+TEST(CircuitBreaker, BuilderOverridesCode) {
+  Backend b;
+  for (int i = 0; i != 4; ++i) {
+    Patched(b, absl::NotFoundError("")).IgnoreError();
+  }
+  EXPECT_EQ(StatusCode::kAborted, Patched(b, 1).status().code());
+  EXPECT_EQ(4, b.calls);
+}
+
+TEST(CircuitBreaker, ErrorRate) {
+  Backend b;
+  // One error in three calls is below the rate.
+  for (int i = 0; i != 30; ++i) {
+    Rate(b, i % 3 == 2 ? absl::NotFoundError("") : absl::StatusOr<int>(1))
+        .IgnoreError();
+  }
+  EXPECT_EQ(30, b.calls);
+  // Now errors are half of the calls.
+  for (int i = 0; i != 10; ++i) Rate(b, absl::NotFoundError("")).IgnoreError();
+  EXPECT_EQ(StatusCode::kUnavailable, Rate(b, 1).status().code());
+  EXPECT_EQ(40, b.calls);
+}
+
+TEST(CircuitBreaker, MinCalls) {
+  Backend b;
+  // Three errors in three calls is not enough.
+  for (int i = 0; i != 3; ++i) Few(b, absl::NotFoundError("")).IgnoreError();
+  EXPECT_EQ(2, *Few(b, 1));
+  EXPECT_EQ(4, b.calls);
+}
+
+TEST(CircuitBreaker, OnlyProbeCloses) {
+  Backend b;
+  // The errors open the breaker while the outer call is in flight. Its success
+  // doesn't close the breaker.
+  EXPECT_EQ(2, *InFlight(b, 4));
+  EXPECT_EQ(5, b.calls);
+  EXPECT_EQ(StatusCode::kUnavailable, InFlight(b, 0).status().code());
+  EXPECT_EQ(5, b.calls);
+}
+
+TEST(CircuitBreaker, Probe) {
+  Backend b;
+  for (int i = 0; i != 2; ++i) Probe(b, absl::NotFoundError("")).IgnoreError();
+  // The cooldown is zero, so every call is a probe. A failed probe keeps the
+  // breaker open.
+  EXPECT_EQ(StatusCode::kNotFound,
+            Probe(b, absl::NotFoundError("")).status().code());
+  EXPECT_EQ(3, b.calls);
+  // A successful probe closes it.
+  EXPECT_EQ(2, *Probe(b, 1));
+  EXPECT_EQ(StatusCode::kNotFound,
+            Probe(b, absl::NotFoundError("")).status().code());
+  EXPECT_EQ(2, *Probe(b, 1));
+  EXPECT_EQ(6, b.calls);
+}
+
+TEST(CircuitBreaker, Window) {
+  Backend b;
+  // Every error starts a new window, so the threshold is never reached.
+  for (int i = 0; i != 10; ++i) {
+    EXPECT_EQ(StatusCode::kNotFound,
+              Window(b, absl::NotFoundError("")).status().code());
+  }
+  EXPECT_EQ(10, b.calls);
+}
+
+TEST(CircuitBreaker, NoCircuitBreaker) {
+  Backend b;
+  for (int i = 0; i != 10; ++i) {
+    EXPECT_EQ(StatusCode::kNotFound,
+              Disabled(b, absl::NotFoundError("")).status().code());
+  }
+  EXPECT_EQ(2, *Disabled(b, 1));
+  EXPECT_EQ(11, b.calls);
+}
+
+}  // namespace
+}  // namespace merror
@@ -0,0 +1,49 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "merror/domain/collect.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include "absl/status/status.h"
+
+namespace merror {
+
+absl::Status ErrorCollector::Summarize(size_t max_listed) const {
+  if (ok()) return absl::OkStatus();
+  std::ostringstream strm;
+  strm << total_ << (total_ == 1 ? " error" : " errors");
+  if (dropped()) strm << " (" << dropped() << " not recorded)";
+  size_t listed = std::min(max_listed, records_.size());
+  for (size_t i = 0; i != listed; ++i) {
+    const Record& r = records_[i];
+    strm << '\n' << r.file << ':' << r.line << ": ";
+    if (r.row >= 0) strm << "row " << r.row << ": ";
+    strm << r.macro_str << '(' << r.args_str << "): "
+         << absl::StatusCodeToString(r.code);
+  }
+  if (listed != total_) strm << "\n... and " << total_ - listed << " more";
+  // Nothing is recorded if the capacity is zero. An error code of OK would turn
+  // the summary into success.
+  absl::StatusCode code =
+      records_.empty() ? absl::StatusCode::kUnknown : records_.front().code;
+  if (code == absl::StatusCode::kOk) code = absl::StatusCode::kUnknown;
+  return absl::Status(code, strm.str());
+}
+
+}  // namespace merror
@@ -0,0 +1,190 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `Collect`. This error domain extension adds method `Collect()` to the
+// policy and the builder. When `Collect(&collector, row)` is called, a pointer
+// to `merror::ErrorCollector` and an optional row index get stored in the
+// policy/builder. Later, if an error is detected, a compact record of it is
+// appended to the collector before returning.
+//
+// Together with `Return()` this allows validating many items without stopping
+// at the first invalid one and without building a `Status` for each of them.
+//
+//   Status ValidateRows(absl::Span<const Row> rows) {
+//     merror::ErrorCollector errors(/*capacity=*/100);
+//     for (size_t i = 0; i != rows.size(); ++i) {
+//       [&] {
+//         // Records errors and returns void, so that the loop carries on.
+//         const auto MErrorDomain =
+//             merror::Default().Collect(&errors, i).Return();
+//         MVERIFY(rows[i].size >= 0).ErrorCode(INVALID_ARGUMENT);
+//         MTRY(ValidateName(rows[i].name));
+//       }();
+//     }
+//     // OK if there were no errors. Otherwise lists them.
+//     return errors.Summarize();
+//   }
+//
+// A record contains the location of the macro, the row index and the error
+// code. The latter is computed with `MakeError(ResultType<absl::StatusCode>(),
+// culprit)`, so an error code must be available: either the culprit carries it
+// (e.g., it's a `Status`), or it's set with `ErrorCode()` or
+// `DefaultErrorCode()`. Textual descriptions are rendered only by
+// `ErrorCollector::Summarize()`, from the macro and its arguments as spelled in
+// the source code.
+//
+// The collector never allocates after construction. Records beyond its
+// capacity are counted but not stored. It isn't thread-safe.
+//
+// `NoCollect()` removes the previously stored collector from the
+// policy/builder.
+
+#ifndef MERROR_5EDA97_DOMAIN_COLLECT_H_
+#define MERROR_5EDA97_DOMAIN_COLLECT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "merror/domain/base.h"
+#include "merror/domain/defer.h"
+#include "merror/domain/observer.h"
+#include "merror/domain/return.h"
+#include "merror/types.h"
+
+namespace merror {
+
+// Bounded accumulator of errors detected by merror macros. See comments at the
+// top of the file.
+class ErrorCollector {
+ public:
+  struct Record {
+    // Identifies the macro expansion. See `Context::location_id`.
+    uintptr_t location_id;
+    // The following four come from the error context and have infinite
+    // lifetime.
+    const char* file;
+    int line;
+    const char* macro_str;
+    const char* args_str;
+    // The row passed to `Collect()`, or -1.
+    int64_t row;
+    absl::StatusCode code;
+  };
+
+  // Preallocates space for `capacity` records.
+  explicit ErrorCollector(size_t capacity) : capacity_(capacity) {
+    records_.reserve(capacity);
+  }
+
+  ErrorCollector(const ErrorCollector&) = delete;
+  ErrorCollector& operator=(const ErrorCollector&) = delete;
+
+  void Add(const Record& record) {
+    ++total_;
+    if (records_.size() < capacity_) records_.push_back(record);
+  }
+
+  // Forgets all errors. Keeps the storage.
+  void Clear() {
+    records_.clear();
+    total_ = 0;
+  }
+
+  // True if no errors have been added.
+  bool ok() const { return total_ == 0; }
+  // The number of added errors, including those that didn't fit.
+  size_t total() const { return total_; }
+  // The number of errors that didn't fit.
+  size_t dropped() const { return total_ - records_.size(); }
+  size_t capacity() const { return capacity_; }
+  // The first `capacity()` errors in the order they were added.
+  const std::vector<Record>& records() const { return records_; }
+
+  // Returns OK if no errors have been added. Otherwise returns a status with
+  // the code of the first error and a message that lists up to `max_listed`
+  // errors, one per line.
+  absl::Status Summarize(size_t max_listed = 10) const;
+
+ private:
+  size_t capacity_;
+  size_t total_ = 0;
+  std::vector<Record> records_;
+};
+
+namespace internal_collect {
+
+struct CollectAnnotation {};
+
+struct Target {
+  ErrorCollector* collector;
+  int64_t row;
+};
+
+template <class Base>
+struct Policy : Base {
+  constexpr auto Collect(ErrorCollector* collector, int64_t row = -1) const {
+    return AddAnnotation<CollectAnnotation>(*this, Target{collector, row});
+  }
+
+  template <class X = void>
+  constexpr auto NoCollect() const
+      -> decltype(RemoveAnnotations<CollectAnnotation>(Defer<X>(*this))) {
+    return RemoveAnnotations<CollectAnnotation>(*this);
+  }
+};
+
+template <class Base>
+struct Builder : Observer<Base> {
+  auto Collect(ErrorCollector* collector, int64_t row = -1) && {
+    return AddAnnotation<CollectAnnotation>(std::move(*this),
+                                            Target{collector, row});
+  }
+
+  template <class X = void>
+  auto NoCollect() && -> decltype(RemoveAnnotations<CollectAnnotation>(
+      std::move(Defer<X>(*this)))) {
+    return RemoveAnnotations<CollectAnnotation>(std::move(*this));
+  }
+
+  template <class RetVal>
+  void ObserveRetVal(const RetVal& ret_val) {
+    // The error code is required only if `Collect()` has been called.
+    if constexpr (HasAnnotation<CollectAnnotation, Base>()) {
+      Target target = GetAnnotation<CollectAnnotation>(*this);
+      if (target.collector) {
+        const auto& ctx = this->context();
+        target.collector->Add(
+            {ctx.location_id, ctx.file, ctx.line, ctx.macro_str, ctx.args_str,
+             target.row,
+             this->derived().MakeError(ResultType<absl::StatusCode>(),
+                                       ctx.culprit)});
+      }
+    }
+    Observer<Base>::ObserveRetVal(ret_val);
+  }
+};
+
+}  // namespace internal_collect
+
+// Error domain extension that adds `Collect()` to the policy and the builder.
+// See comments at the top of the file for details.
+using Collect = Domain<internal_collect::Policy, internal_collect::Builder>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_COLLECT_H_
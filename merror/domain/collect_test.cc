@@ -0,0 +1,135 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "merror/domain/collect.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::absl::StatusCode;
+using ::testing::HasSubstr;
+
+absl::StatusOr<int> Parse(int n) {
+  if (n == 13) return absl::NotFoundError("unlucky");
+  return n;
+}
+
+TEST(Collect, ContinuesAfterErrors) {
+  ErrorCollector errors(10);
+  std::vector<int> valid;
+  for (int n : {1, -2, 3, 13, 5}) {
+    [&] {
+      const auto MErrorDomain = merror::Default().Collect(&errors, n).Return();
+      MVERIFY(n >= 0).ErrorCode(StatusCode::kInvalidArgument);
+      valid.push_back(MTRY(Parse(n)));
+    }();
+  }
+  EXPECT_THAT(valid, ::testing::ElementsAre(1, 3, 5));
+  EXPECT_FALSE(errors.ok());
+  EXPECT_EQ(2, errors.total());
+  EXPECT_EQ(0, errors.dropped());
+  ASSERT_EQ(2, errors.records().size());
+
+  const ErrorCollector::Record& r0 = errors.records()[0];
+  EXPECT_EQ(-2, r0.row);
+  EXPECT_EQ(StatusCode::kInvalidArgument, r0.code);
+  EXPECT_STREQ("MVERIFY", r0.macro_str);
+  EXPECT_STREQ("n >= 0", r0.args_str);
+  EXPECT_NE(0, r0.location_id);
+
+  const ErrorCollector::Record& r1 = errors.records()[1];
+  EXPECT_EQ(13, r1.row);
+  // The code comes from the culprit.
+  EXPECT_EQ(StatusCode::kNotFound, r1.code);
+  EXPECT_STREQ("MTRY", r1.macro_str);
+  EXPECT_NE(r0.location_id, r1.location_id);
+}
+
+TEST(Collect, Summarize) {
+  ErrorCollector errors(2);
+  EXPECT_TRUE(errors.Summarize().ok());
+  for (int i = 0; i != 4; ++i) {
+    [&] {
+      const auto MErrorDomain = merror::Default()
+                                    .DefaultErrorCode(StatusCode::kOutOfRange)
+                                    .Collect(&errors, i);
+      MVERIFY(i > 5).Return();
+    }();
+  }
+  EXPECT_EQ(4, errors.total());
+  EXPECT_EQ(2, errors.dropped());
+  absl::Status s = errors.Summarize(1);
+  EXPECT_EQ(StatusCode::kOutOfRange, s.code());
+  std::string msg(s.message());
+  EXPECT_THAT(msg, HasSubstr("4 errors (2 not recorded)"));
+  EXPECT_THAT(msg, HasSubstr("collect_test.cc:"));
+  EXPECT_THAT(msg, HasSubstr("row 0: MVERIFY(i > 5): OUT_OF_RANGE"));
+  EXPECT_THAT(msg, ::testing::Not(HasSubstr("row 1")));
+  EXPECT_THAT(msg, HasSubstr("... and 3 more"));
+
+  errors.Clear();
+  EXPECT_TRUE(errors.ok());
+  EXPECT_TRUE(errors.Summarize().ok());
+}
+
+TEST(Collect, BuilderLevel) {
+  ErrorCollector errors(1);
+  auto F = [&](bool ok) -> absl::Status {
+    const auto MErrorDomain = merror::Default();
+    MVERIFY(ok).ErrorCode(StatusCode::kAborted).Collect(&errors);
+    return absl::OkStatus();
+  };
+  EXPECT_TRUE(F(true).ok());
+  EXPECT_TRUE(errors.ok());
+  // Collecting doesn't change the returned error.
+  EXPECT_EQ(StatusCode::kAborted, F(false).code());
+  ASSERT_EQ(1, errors.total());
+  EXPECT_EQ(-1, errors.records()[0].row);
+  EXPECT_EQ(StatusCode::kAborted, errors.records()[0].code);
+}
+
+TEST(Collect, NoCollect) {
+  ErrorCollector errors(1);
+  auto F = [&] {
+    const auto MErrorDomain = merror::Default().Collect(&errors).NoCollect();
+    MVERIFY(false).Return();
+  };
+  F();
+  EXPECT_TRUE(errors.ok());
+}
+
+TEST(Collect, ZeroCapacity) {
+  ErrorCollector errors(0);
+  [&] {
+    const auto MErrorDomain = merror::Default().Collect(&errors);
+    MVERIFY(absl::InternalError("")).Return();
+  }();
+  EXPECT_EQ(1, errors.total());
+  EXPECT_TRUE(errors.records().empty());
+  EXPECT_EQ(StatusCode::kUnknown, errors.Summarize().code());
+}
+
+}  // namespace
+}  // namespace merror
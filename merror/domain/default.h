@@ -50,8 +50,10 @@
 #include "merror/domain/adl_hooks.h"
 #include "merror/domain/base.h"
 #include "merror/domain/bool.h"
+#include "merror/domain/collect.h"
 #include "merror/domain/description.h"
 #include "merror/domain/error_passthrough.h"
+#include "merror/domain/expect_errors.h"
 #include "merror/domain/fill_error.h"
 #include "merror/domain/forward.h"
 #include "merror/domain/function.h"
@@ -63,6 +65,7 @@
 #include "merror/domain/print_operands.h"
 #include "merror/domain/return.h"
 #include "merror/domain/status.h"
+#include "merror/domain/system_error.h"
 #include "merror/domain/tee.h"
 #include "merror/domain/verify_via_try.h"
 
@@ -71,30 +74,36 @@ namespace merror {
 namespace internal_default {
 
 template <class Base>
-using Policy = internal_status::AcceptStatus<internal_pointer::AcceptPointer<
-    internal_function::AcceptFunction<internal_optional::AcceptOptional<
-        internal_bool::AcceptBool<internal_logging::Policy<
-            internal_status::StatusBuilder::Policy<internal_description::Policy<
-                internal_tee::Policy<internal_return::Policy<
-                    internal_forward::Facade<internal_print_operands::Printer<
-                        internal_print::Policy<internal_method_hooks::Policy<
-                            internal_adl_hooks::Policy<
-                                internal_verify_via_try::Policy<
-                                    Base>>>>>>>>>>>>>>>>;
+using Policy = internal_expect_errors::Policy<
+    internal_system_error::AcceptSystemError<internal_status::AcceptStatus<
+        internal_pointer::AcceptPointer<internal_function::AcceptFunction<
+            internal_optional::AcceptOptional<internal_bool::AcceptBool<
+                internal_logging::Policy<internal_status::StatusBuilder::Policy<
+                    internal_description::Policy<internal_collect::Policy<
+                        internal_tee::Policy<internal_return::Policy<
+                            internal_forward::Facade<
+                                internal_print_operands::Printer<
+                                    internal_print::Policy<
+                                        internal_method_hooks::Policy<
+                                            internal_adl_hooks::Policy<
+                                                internal_verify_via_try::Policy<
+                                                    Base>>>>>>>>>>>>>>>>>>>;
 
 template <class Base>
-using Builder = internal_status::MakeStatus<
-    internal_pointer::MakePointer<internal_function::MakeFunction<
-        internal_optional::MakeOptional<internal_bool::MakeBool<
-            internal_logging::Builder<internal_status::StatusBuilder::Builder<
-                internal_description::Builder<
-                    internal_tee::Builder<internal_return::Builder<
-                        internal_print::Builder<internal_method_hooks::Builder<
-                            internal_adl_hooks::Builder<
-                                internal_status::MakeStatusFallback<
-                                    internal_error_passthrough::Builder<
-                                        internal_fill_error::Builder<
-                                            Base>>>>>>>>>>>>>>>>;
+using Builder = internal_system_error::MakeSystemError<
+    internal_status::MakeStatus<internal_pointer::MakePointer<
+        internal_function::MakeFunction<internal_optional::MakeOptional<
+            internal_bool::MakeBool<internal_logging::Builder<
+                internal_status::StatusBuilder::Builder<
+                    internal_description::Builder<internal_collect::Builder<
+                        internal_tee::Builder<internal_return::Builder<
+                            internal_print::Builder<
+                                internal_method_hooks::Builder<
+                                    internal_adl_hooks::Builder<
+                                        internal_status::MakeStatusFallback<
+                                            internal_error_passthrough::Builder<
+                                                internal_fill_error::Builder<
+                                                    Base>>>>>>>>>>>>>>>>>>;
 
 }  // namespace internal_default
 
@@ -109,11 +118,12 @@ using Builder = internal_status::MakeStatus<
 //       // Order matters here: method hooks trump ADL hooks.
 //       AdlHooks(), MethodHooks(),
 //       // For the remaining extensions order doesn't matter.
-//       Print(), PrintOperands(), Forward(), Return(), Tee(),
+//       Print(), PrintOperands(), Forward(), Return(), Tee(), Collect(),
 //       DescriptionBuilder(), StatusBuilder(), Logging(), AcceptBool(),
 //       MakeBool(), AcceptOptional(), MakeOptional(), AcceptFunction(),
 //       MakeFunction(), AcceptPointer(), MakePointer(), AcceptStatus(),
-//       MakeStatus(), FillRpc(), FillTask()));
+//       MakeStatus(), FillRpc(), FillTask(), AcceptSystemError(),
+//       MakeSystemError(), ExpectErrors()));
 //
 // Its type is expanded to reduce compilation time.
 using Default = Domain<internal_default::Policy, internal_default::Builder>;
@@ -45,7 +45,7 @@
 
 #include "merror/domain/base.h"
 #include "merror/domain/defer.h"
-#include "merror/domain/internal/stringstream.h"
+#include "merror/domain/internal/indenting_stream.h"
 
 namespace merror {
 
@@ -177,15 +177,16 @@ struct Print<0> {
 
 // Produces the value of `PolicyDescriptionAnnotation` from all instances of
 // `StreamableAnnotation`.
+// Formats into a reusable per-thread buffer, so that the result is the only
+// allocation.
 template <class Policy>
 std::string MakePolicyDescription(const Policy& policy) {
-  std::string buffer;
-  internal::StringStream strm(&buffer);
+  internal::ScratchStream scratch;
   // It's a tuple of references to everything that has been streamed into the
   // policy. The elements are in the reverse order.
   auto values = GetAnnotations<StreamableAnnotation>(policy);
-  Print<std::tuple_size<decltype(values)>::value>()(values, &strm);
-  return buffer;
+  Print<std::tuple_size<decltype(values)>::value>()(values, &*scratch);
+  return scratch->str();
 }
 
 // This policy extension allows objects to be streamed into merror policies.
@@ -364,36 +365,51 @@ struct Builder : Base {};
 
 class BuilderStream {
  public:
-  explicit operator std::string_view() const { return strm_->buffer; }
-  std::ostream& strm() { return strm_->stream; }
+  explicit operator std::string_view() const { return strm_->str(); }
+  std::ostream& strm() { return *strm_; }
 
  private:
-  // StringStream isn't movable, so we store it on the heap.
-  struct Stream {
-    std::string buffer;
-    internal::StringStream stream{&buffer};
-  };
-  std::unique_ptr<Stream> strm_{new Stream};
+  // Streams and their buffers are reused across errors.
+  internal::ScratchStream strm_;
 };
 
-template <class Base, class T,
-          EnableIf<HasAnnotation<BuilderDescriptionAnnotation, Base>()> = 0>
-typename Base::BuilderType&& Write(Builder<Base>&& b, const T& val) {
-  GetAnnotation<BuilderDescriptionAnnotation>(b).strm() << val;
+// Writes `val` into the builder description of `b` with `Append()(desc, val)`.
+// If `b` doesn't have a builder description yet, `Description()` is added
+// first. Shared by the domain extensions that implement `operator<<` for
+// builders.
+template <class Description, class Append, class B, class T,
+          EnableIf<HasAnnotation<BuilderDescriptionAnnotation, B>()> = 0>
+typename B::BuilderType&& WriteDescription(B&& b, const T& val) {
+  Append()(GetAnnotation<BuilderDescriptionAnnotation>(b), val);
   return std::move(b.derived());
 }
 
-template <class Base, class T,
-          EnableIf<!HasAnnotation<BuilderDescriptionAnnotation, Base>()> = 0>
-auto Write(Builder<Base>&& b, const T& val)
+template <class Description, class Append, class B, class T,
+          EnableIf<!HasAnnotation<BuilderDescriptionAnnotation, B>()> = 0>
+auto WriteDescription(B&& b, const T& val)
     -> decltype(AddAnnotation<BuilderDescriptionAnnotation>(std::move(b),
-                                                            BuilderStream())) {
-  return internal_description::Write(
-      AddAnnotation<BuilderDescriptionAnnotation>(std::move(b),
-                                                  BuilderStream()),
+                                                            Description())) {
+  return internal_description::WriteDescription<Description, Append>(
+      AddAnnotation<BuilderDescriptionAnnotation>(std::move(b), Description()),
       val);
 }
 
+struct StreamAppend {
+  template <class T>
+  void operator()(BuilderStream& s, const T& val) const {
+    s.strm() << val;
+  }
+};
+
+template <class Base, class T>
+auto Write(Builder<Base>&& b, const T& val)
+    -> decltype(internal_description::WriteDescription<BuilderStream,
+                                                       StreamAppend>(
+        std::move(b), val)) {
+  return internal_description::WriteDescription<BuilderStream, StreamAppend>(
+      std::move(b), val);
+}
+
 template <class Base, class T>
 auto operator<<(Builder<Base>&& b, const T& val)
     -> decltype(internal_description::Write(std::move(b), val)) {
@@ -0,0 +1,188 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/error_stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace merror {
+
+struct ErrorStatsTable::Header {
+  // "MERRSTAT" in memory on little-endian machines.
+  static constexpr uint64_t kMagic = 0x544154535252454d;
+  static constexpr uint32_t kVersion = 1;
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t slot_size;
+  uint32_t num_slots;
+  std::atomic<uint64_t> overflow;
+};
+
+namespace {
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "");
+
+constexpr size_t kHeaderSize = sizeof(ErrorStatsSlot);
+
+std::atomic<uint32_t> next_generation{1};
+
+// Maps `fd` and closes it. Returns null on failure.
+void* Map(int fd, size_t size, bool writable) {
+  int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* addr = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+  int err = errno;
+  close(fd);
+  errno = err;
+  return addr == MAP_FAILED ? nullptr : addr;
+}
+
+}  // namespace
+
+std::unique_ptr<ErrorStatsTable> ErrorStatsTable::Create(const char* name,
+                                                         uint32_t num_slots) {
+  static_assert(sizeof(Header) <= kHeaderSize, "");
+  shm_unlink(name);
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) return nullptr;
+  size_t size = kHeaderSize + size_t{num_slots} * sizeof(ErrorStatsSlot);
+  if (ftruncate(fd, size) != 0) {
+    int err = errno;
+    close(fd);
+    shm_unlink(name);
+    errno = err;
+    return nullptr;
+  }
+  void* addr = Map(fd, size, /*writable=*/true);
+  if (!addr) return nullptr;
+  // The segment is zero-filled, which is a valid state for all slots.
+  Header* header = new (addr) Header;
+  header->version = Header::kVersion;
+  header->slot_size = sizeof(ErrorStatsSlot);
+  header->num_slots = num_slots;
+  header->overflow.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  // Readers check the magic last.
+  header->magic = Header::kMagic;
+  return std::unique_ptr<ErrorStatsTable>(
+      new ErrorStatsTable(addr, size, /*writable=*/true));
+}
+
+std::unique_ptr<ErrorStatsTable> ErrorStatsTable::Open(const char* name) {
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize) {
+    int err = errno;
+    close(fd);
+    errno = err ? err : EINVAL;
+    return nullptr;
+  }
+  size_t size = st.st_size;
+  void* addr = Map(fd, size, /*writable=*/false);
+  if (!addr) return nullptr;
+  const Header* header = static_cast<const Header*>(addr);
+  if (header->magic != Header::kMagic || header->version != Header::kVersion ||
+      header->slot_size != sizeof(ErrorStatsSlot) ||
+      kHeaderSize + size_t{header->num_slots} * sizeof(ErrorStatsSlot) >
+          size) {
+    munmap(addr, size);
+    errno = EINVAL;
+    return nullptr;
+  }
+  return std::unique_ptr<ErrorStatsTable>(
+      new ErrorStatsTable(addr, size, /*writable=*/false));
+}
+
+bool ErrorStatsTable::Remove(const char* name) {
+  return shm_unlink(name) == 0;
+}
+
+ErrorStatsTable::ErrorStatsTable(void* addr, size_t size, bool writable)
+    : addr_(addr),
+      size_(size),
+      writable_(writable),
+      header_(static_cast<Header*>(addr)),
+      slots_(reinterpret_cast<ErrorStatsSlot*>(static_cast<char*>(addr) +
+                                               kHeaderSize)),
+      num_slots_(header_->num_slots),
+      generation_(next_generation.fetch_add(1, std::memory_order_relaxed)) {}
+
+ErrorStatsTable::~ErrorStatsTable() { munmap(addr_, size_); }
+
+ErrorStatsSlot* ErrorStatsTable::ClaimSlot(std::atomic<uint64_t>& cache,
+                                           uintptr_t location_id,
+                                           const char* file, int line) {
+  if (!writable_) return nullptr;
+  uint32_t index = 0;
+  // Open addressing with linear probing. Slots are never freed.
+  uint64_t h = location_id * 0x9E3779B97F4A7C15;
+  for (uint32_t i = 0; i != num_slots_; ++i) {
+    uint32_t n = static_cast<uint32_t>((h + i) % num_slots_);
+    ErrorStatsSlot& slot = slots_[n];
+    uint64_t id = slot.location_id.load(std::memory_order_relaxed);
+    if (id == 0 && slot.location_id.compare_exchange_strong(
+                       id, location_id, std::memory_order_relaxed)) {
+      size_t len = strlen(file);
+      const char* tail = file + len - std::min(len, sizeof(slot.file) - 1);
+      strncpy(slot.file, tail, sizeof(slot.file) - 1);
+      slot.last_code.store(-1, std::memory_order_relaxed);
+      slot.line.store(line, std::memory_order_release);
+      index = n + 1;
+      break;
+    }
+    if (id == location_id) {
+      index = n + 1;
+      break;
+    }
+  }
+  if (index == 0) header_->overflow.fetch_add(1, std::memory_order_relaxed);
+  cache.store(uint64_t{generation_} << 32 | index, std::memory_order_relaxed);
+  return index ? &slots_[index - 1] : nullptr;
+}
+
+std::vector<SiteErrorStats> ErrorStatsTable::Snapshot() const {
+  std::vector<SiteErrorStats> res;
+  for (uint32_t i = 0; i != num_slots_; ++i) {
+    const ErrorStatsSlot& slot = slots_[i];
+    int line = slot.line.load(std::memory_order_acquire);
+    if (line == 0) continue;
+    std::string file(slot.file, strnlen(slot.file, sizeof(slot.file)));
+    res.push_back({std::move(file), line,
+                   slot.errors.load(std::memory_order_relaxed),
+                   slot.logged.load(std::memory_order_relaxed),
+                   slot.suppressed.load(std::memory_order_relaxed),
+                   slot.last_code.load(std::memory_order_relaxed)});
+  }
+  return res;
+}
+
+uint64_t ErrorStatsTable::overflow() const {
+  return header_->overflow.load(std::memory_order_relaxed);
+}
+
+void SetErrorStatsTable(ErrorStatsTable* table) {
+  internal_error_stats::table.store(table, std::memory_order_release);
+}
+
+}  // namespace merror
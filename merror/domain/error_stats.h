@@ -0,0 +1,214 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `ErrorStatsTable` and `ErrorStats`. An `ErrorStatsTable` is a named
+// POSIX shared memory segment with per-site error counters, so that another
+// process can scrape them without an exporter thread in the process that
+// produces errors. The `ErrorStats` error domain extension counts errors and
+// remembers the last status code of each site. `Logging` counts the records it
+// has logged and suppressed.
+//
+//   int main() {
+//     static auto* table =
+//         merror::ErrorStatsTable::Create("/myserver.merror", 4096).release();
+//     merror::SetErrorStatsTable(table);
+//     ...
+//   }
+//
+//   constexpr auto MErrorDomain = merror::Default().With(merror::ErrorStats());
+//
+//   $ error_stats_dump /myserver.merror
+//
+// The segment consists of a 64-byte header followed by a fixed array of
+// 64-byte slots, one per site. Sites claim slots on their first error. Once a
+// site knows its slot, counting an error is a relaxed increment. When the
+// table is full, new sites aren't counted; the header counts them instead.
+//
+// Sites are identified by `Context::location_id`, so the table is only
+// meaningful while the process that has created it is running. `Create()`
+// replaces an existing segment with the same name. Slots store the last 23
+// characters of the file name.
+//
+// The table must outlive all errors that may be counted in it. In practice it
+// should be created at startup and never destroyed.
+
+#ifndef MERROR_5EDA97_DOMAIN_ERROR_STATS_H_
+#define MERROR_5EDA97_DOMAIN_ERROR_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "merror/domain/base.h"
+#include "merror/domain/observer.h"
+#include "merror/types.h"
+
+namespace merror {
+
+// A single site in `ErrorStatsTable`. Exactly one cache line.
+struct alignas(64) ErrorStatsSlot {
+  // Zero if the slot is free.
+  std::atomic<uint64_t> location_id;
+  std::atomic<uint64_t> errors;
+  std::atomic<uint64_t> logged;
+  std::atomic<uint64_t> suppressed;
+  // The status code of the last error or -1 if it had none.
+  std::atomic<int32_t> last_code;
+  // Zero until `file` has been written.
+  std::atomic<int32_t> line;
+  // The tail of the file name. Null-terminated.
+  char file[24];
+};
+
+static_assert(sizeof(ErrorStatsSlot) == 64, "");
+
+// Counters of a single site as seen by `ErrorStatsTable::Snapshot()`.
+struct SiteErrorStats {
+  std::string file;
+  int line;
+  uint64_t errors;
+  uint64_t logged;
+  uint64_t suppressed;
+  int last_code;
+};
+
+// See comments at the top of the file.
+class ErrorStatsTable {
+ public:
+  // Creates shared memory segment `name` with room for `num_slots` sites,
+  // replacing the segment with the same name if there is one. The name must
+  // start with a slash. Returns null and sets `errno` on failure.
+  static std::unique_ptr<ErrorStatsTable> Create(const char* name,
+                                                 uint32_t num_slots);
+
+  // Maps an existing segment read-only. Returns null and sets `errno` on
+  // failure.
+  static std::unique_ptr<ErrorStatsTable> Open(const char* name);
+
+  // Removes the segment. Processes that have mapped it keep their mapping.
+  static bool Remove(const char* name);
+
+  // Unmaps the segment without removing it.
+  ~ErrorStatsTable();
+
+  ErrorStatsTable(const ErrorStatsTable&) = delete;
+  ErrorStatsTable& operator=(const ErrorStatsTable&) = delete;
+
+  // Returns the slot of the site, claiming a free one if the site doesn't have
+  // one. Returns null if the table is full or read-only.
+  ErrorStatsSlot* GetSlot(uintptr_t location_id, const char* file, int line) {
+    std::atomic<uint64_t>& cache =
+        internal::GetSiteState(location_id).stats_slot;
+    uint64_t cached = cache.load(std::memory_order_relaxed);
+    if (cached >> 32 == generation_) {
+      uint32_t index = static_cast<uint32_t>(cached);
+      return index ? &slots_[index - 1] : nullptr;
+    }
+    return ClaimSlot(cache, location_id, file, line);
+  }
+
+  // Returns the counters of all sites that have claimed a slot.
+  std::vector<SiteErrorStats> Snapshot() const;
+
+  uint32_t num_slots() const { return num_slots_; }
+
+  // The number of sites that didn't get a slot because the table was full.
+  uint64_t overflow() const;
+
+ private:
+  struct Header;
+
+  ErrorStatsTable(void* addr, size_t size, bool writable);
+
+  ErrorStatsSlot* ClaimSlot(std::atomic<uint64_t>& cache, uintptr_t location_id,
+                            const char* file, int line);
+
+  void* addr_;
+  size_t size_;
+  bool writable_;
+  Header* header_;
+  ErrorStatsSlot* slots_;
+  uint32_t num_slots_;
+  // Unique among the tables of the process. Never zero.
+  uint32_t generation_;
+};
+
+// Sets the table in which errors are counted. Null disables counting.
+void SetErrorStatsTable(ErrorStatsTable* table);
+
+namespace internal_error_stats {
+
+inline std::atomic<ErrorStatsTable*> table{nullptr};
+
+inline ErrorStatsSlot* GetSlot(uintptr_t location_id, const char* file,
+                               int line) {
+  ErrorStatsTable* t = table.load(std::memory_order_acquire);
+  return t ? t->GetSlot(location_id, file, line) : nullptr;
+}
+
+// Called by `Logging` for every error for which logging is enabled.
+inline void CountLog(uintptr_t location_id, const char* file, int line,
+                     bool logged) {
+  if (ErrorStatsSlot* slot = GetSlot(location_id, file, line)) {
+    (logged ? slot->logged : slot->suppressed)
+        .fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+inline int CodeOf(const absl::Status& status) {
+  return static_cast<int>(status.code());
+}
+
+inline int CodeOf(absl::StatusCode code) { return static_cast<int>(code); }
+
+template <class T>
+int CodeOf(const absl::StatusOr<T>& status_or) {
+  return CodeOf(status_or.status());
+}
+
+template <class T>
+int CodeOf(const T&) {
+  return -1;
+}
+
+template <class Base>
+struct Builder : Observer<Base> {
+  template <class RetVal>
+  void ObserveRetVal(const RetVal& ret_val) {
+    const auto& ctx = this->context();
+    if (ErrorStatsSlot* slot = GetSlot(ctx.location_id, ctx.file, ctx.line)) {
+      slot->errors.fetch_add(1, std::memory_order_relaxed);
+      int code = CodeOf(ret_val);
+      if (code < 0) code = CodeOf(ctx.culprit);
+      slot->last_code.store(code, std::memory_order_relaxed);
+    }
+    Observer<Base>::ObserveRetVal(ret_val);
+  }
+};
+
+}  // namespace internal_error_stats
+
+// Error domain extension that counts errors in the table passed to
+// `SetErrorStatsTable()`. See comments at the top of the file for details.
+using ErrorStats = Builder<internal_error_stats::Builder>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_ERROR_STATS_H_
@@ -0,0 +1,65 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Prints a snapshot of an error statistics table created by another process.
+// See //merror/domain/error_stats.h.
+//
+//   $ error_stats_dump /myserver.merror
+//   file                    line  errors  logged  suppressed  last_code
+//   server/handler.cc        123    1045      17        1028          5
+//   ...
+//
+// Sites are sorted by the number of errors, most first.
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "merror/domain/error_stats.h"
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::fprintf(stderr, "Usage: %s <shared memory name>\n", argv[0]);
+    return 2;
+  }
+  std::unique_ptr<merror::ErrorStatsTable> table =
+      merror::ErrorStatsTable::Open(argv[1]);
+  if (!table) {
+    std::fprintf(stderr, "Cannot open %s: %s\n", argv[1], strerror(errno));
+    return 1;
+  }
+  std::vector<merror::SiteErrorStats> sites = table->Snapshot();
+  std::sort(sites.begin(), sites.end(),
+            [](const merror::SiteErrorStats& a,
+               const merror::SiteErrorStats& b) {
+              return a.errors > b.errors;
+            });
+  std::printf("%-23s %5s %7s %7s %11s %10s\n", "file", "line", "errors",
+              "logged", "suppressed", "last_code");
+  for (const merror::SiteErrorStats& s : sites) {
+    std::printf("%-23s %5d %7llu %7llu %11llu %10d\n", s.file.c_str(), s.line,
+                static_cast<unsigned long long>(s.errors),
+                static_cast<unsigned long long>(s.logged),
+                static_cast<unsigned long long>(s.suppressed), s.last_code);
+  }
+  if (uint64_t overflow = table->overflow()) {
+    std::printf("%llu sites didn't fit into %u slots\n",
+                static_cast<unsigned long long>(overflow), table->num_slots());
+  }
+  return 0;
+}
@@ -0,0 +1,127 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/error_stats.h"
+
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/domain/internal/capture_stream.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::testing::EndsWith;
+using ::testing::IsEmpty;
+
+constexpr auto MErrorDomain = Default().With(ErrorStats());
+
+class ErrorStatsTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<ErrorStatsTable> Create(uint32_t num_slots) {
+    auto table = ErrorStatsTable::Create(name_.c_str(), num_slots);
+    SetErrorStatsTable(table.get());
+    return table;
+  }
+
+  ~ErrorStatsTest() override {
+    SetErrorStatsTable(nullptr);
+    ErrorStatsTable::Remove(name_.c_str());
+  }
+
+  const std::string name_ =
+      "/merror_error_stats_test." + std::to_string(getpid());
+};
+
+absl::Status FailOnce() {
+  MVERIFY(false).ErrorCode(absl::StatusCode::kNotFound);
+  return absl::OkStatus();
+}
+
+absl::Status LogOnce() {
+  MVERIFY(false).ErrorCode(absl::StatusCode::kAborted).CerrLog(FirstN(1));
+  return absl::OkStatus();
+}
+
+void Fail(int n) {
+  for (int i = 0; i != n; ++i) FailOnce().IgnoreError();
+}
+
+void Logged(int n) {
+  internal::CaptureStream c(std::cerr);
+  for (int i = 0; i != n; ++i) LogOnce().IgnoreError();
+}
+
+TEST_F(ErrorStatsTest, CountsErrors) {
+  auto table = Create(16);
+  ASSERT_TRUE(table);
+  Fail(3);
+  Logged(4);
+  // Read the segment the way another process would.
+  auto reader = ErrorStatsTable::Open(name_.c_str());
+  ASSERT_TRUE(reader);
+  std::vector<SiteErrorStats> sites = reader->Snapshot();
+  ASSERT_EQ(2, sites.size());
+  if (sites[0].last_code != 5) std::swap(sites[0], sites[1]);
+  EXPECT_THAT(sites[0].file, EndsWith("/error_stats_test.cc"));
+  EXPECT_EQ(3, sites[0].errors);
+  EXPECT_EQ(0, sites[0].logged);
+  EXPECT_EQ(0, sites[0].suppressed);
+  EXPECT_EQ(5, sites[0].last_code);
+  EXPECT_EQ(4, sites[1].errors);
+  EXPECT_EQ(1, sites[1].logged);
+  EXPECT_EQ(3, sites[1].suppressed);
+  EXPECT_EQ(10, sites[1].last_code);
+  EXPECT_EQ(0, reader->overflow());
+}
+
+TEST_F(ErrorStatsTest, Overflow) {
+  auto table = Create(1);
+  ASSERT_TRUE(table);
+  Fail(2);
+  Logged(2);
+  std::vector<SiteErrorStats> sites = table->Snapshot();
+  ASSERT_EQ(1, sites.size());
+  EXPECT_EQ(2, sites[0].errors);
+  EXPECT_EQ(1, table->overflow());
+}
+
+TEST_F(ErrorStatsTest, NewTable) {
+  auto table = Create(4);
+  ASSERT_TRUE(table);
+  Fail(1);
+  table = Create(4);
+  ASSERT_TRUE(table);
+  EXPECT_THAT(table->Snapshot(), IsEmpty());
+  Fail(1);
+  std::vector<SiteErrorStats> sites = table->Snapshot();
+  ASSERT_EQ(1, sites.size());
+  EXPECT_EQ(1, sites[0].errors);
+}
+
+TEST_F(ErrorStatsTest, NoTable) {
+  Fail(1);
+  EXPECT_FALSE(ErrorStatsTable::Open(name_.c_str()));
+}
+
+}  // namespace
+}  // namespace merror
@@ -0,0 +1,82 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `ExpectErrors`. This error domain extension adds method
+// `ExpectErrors()` to the policy. `MVERIFY()` and `MTRY()` tell the compiler
+// that their argument is unlikely to be an error, which moves the failure path
+// out of line. That's wrong for sites where errors are a regular outcome, such
+// as cache lookups and parser probes that fail on every third call. At sites
+// that use a policy with `ExpectErrors()`, neither outcome is favored, and the
+// failure path stays inline.
+//
+//   StatusOr<Token> ParseToken(Lexer& lexer) {
+//     // Each alternative fails unless the next token is of its kind.
+//     MERROR_DOMAIN().ExpectErrors();
+//     ...
+//   }
+//
+// To tag a single site, give it its own scope:
+//
+//   {
+//     MERROR_DOMAIN().ExpectErrors();
+//     value = MTRY(cache.Lookup(key));
+//   }
+//
+// The hint is a property of the policy type, so it costs nothing at run time.
+// `Default()` includes the extension. `NoExpectErrors()` removes the tag.
+//
+// `FindErrorProneSites()` in //merror/domain/timed.h lists the sites whose
+// sampled error rate suggests tagging them.
+
+#ifndef MERROR_5EDA97_DOMAIN_EXPECT_ERRORS_H_
+#define MERROR_5EDA97_DOMAIN_EXPECT_ERRORS_H_
+
+#include "merror/domain/base.h"
+#include "merror/domain/defer.h"
+
+namespace merror {
+namespace internal_expect_errors {
+
+struct ExpectErrorsAnnotation {};
+
+template <class Base>
+struct Policy : Base {
+  template <class X = void>
+  constexpr auto ExpectErrors() const
+      -> decltype(AddAnnotation<ExpectErrorsAnnotation>(Defer<X>(*this),
+                                                        true)) {
+    return AddAnnotation<ExpectErrorsAnnotation>(*this, true);
+  }
+
+  template <class X = void>
+  constexpr auto NoExpectErrors() const
+      -> decltype(RemoveAnnotations<ExpectErrorsAnnotation>(Defer<X>(*this))) {
+    return RemoveAnnotations<ExpectErrorsAnnotation>(*this);
+  }
+
+  // Called by `MVERIFY()` and `MTRY()`.
+  static constexpr bool ExpectsErrors() {
+    return HasAnnotation<ExpectErrorsAnnotation, Base>();
+  }
+};
+
+}  // namespace internal_expect_errors
+
+// Error domain extension that adds `ExpectErrors()` to the policy. See comments
+// at the top of the file for details.
+using ExpectErrors = Policy<internal_expect_errors::Policy>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_EXPECT_ERRORS_H_
@@ -0,0 +1,84 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/expect_errors.h"
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::absl::StatusCode;
+using ::merror::internal_macros::ExpectsErrors;
+
+constexpr auto MErrorDomain =
+    Default().DefaultErrorCode(StatusCode::kUnknown).ExpectErrors();
+
+struct NotMErrorDomain {};
+
+static_assert(!ExpectsErrors<decltype(Default())>(0), "");
+static_assert(ExpectsErrors<decltype(MErrorDomain)>(0), "");
+static_assert(ExpectsErrors<const decltype(MErrorDomain)&>(0), "");
+static_assert(!ExpectsErrors<decltype(MErrorDomain.NoExpectErrors())>(0), "");
+static_assert(
+    ExpectsErrors<decltype(EmptyDomain().With(ExpectErrors()).ExpectErrors())>(
+        0),
+    "");
+static_assert(!ExpectsErrors<NotMErrorDomain>(0), "");
+
+absl::StatusOr<int> Try(absl::StatusOr<int> x) { return MTRY(x) + 1; }
+
+absl::Status Verify(int n) {
+  MVERIFY(n > 0) << "Probe";
+  return absl::OkStatus();
+}
+
+absl::StatusOr<int> SingleSite(absl::StatusOr<int> x, int n) {
+  MVERIFY(n >= 0);
+  int res;
+  {
+    MERROR_DOMAIN().NoExpectErrors();
+    res = MTRY(x);
+  }
+  return res + n;
+}
+
+TEST(ExpectErrors, Try) {
+  EXPECT_EQ(2, *Try(1));
+  EXPECT_EQ(StatusCode::kNotFound,
+            Try(absl::NotFoundError("")).status().code());
+}
+
+TEST(ExpectErrors, Verify) {
+  EXPECT_TRUE(Verify(1).ok());
+  absl::Status s = Verify(0);
+  EXPECT_EQ(StatusCode::kUnknown, s.code());
+  EXPECT_NE(std::string::npos, s.message().find("Probe"));
+}
+
+TEST(ExpectErrors, SingleSite) {
+  EXPECT_EQ(3, *SingleSite(1, 2));
+  EXPECT_EQ(StatusCode::kNotFound,
+            SingleSite(absl::NotFoundError(""), 2).status().code());
+  EXPECT_EQ(StatusCode::kUnknown, SingleSite(1, -1).status().code());
+}
+
+}  // namespace
+}  // namespace merror
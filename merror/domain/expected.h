@@ -0,0 +1,125 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This library defines error domain extensions for dealing with
+// `std::expected<T, E>` as an error type. They require C++23 and therefore
+// aren't a part of `merror::Default()`; add them explicitly.
+//
+//   constexpr auto MErrorDomain =
+//       merror::Default().With(merror::AcceptExpected(), merror::MakeExpected());
+//
+// `MTRY(exp)` returns an error from the current function if `exp` holds an
+// error. Otherwise it evaluates to `*exp`; the value is moved out if `exp` is
+// an rvalue. `MVERIFY(exp)` works too. In both cases the culprit is
+// `exp.error()`.
+//
+// Functions returning `std::expected<T, E>` or `std::unexpected<E>` can use
+// merror macros. The error of type `E` is built from the culprit with
+// `MakeError()`, so any extension that can produce `E` works. For example,
+// `merror::MakeStatus()` can produce `absl::StatusCode`, which makes
+// `std::expected<T, absl::StatusCode>` an allocation-free error type.
+//
+//   std::expected<int, absl::StatusCode> ParseDigit(char c) {
+//     MVERIFY(c >= '0' && c <= '9').ErrorCode(absl::StatusCode::kOutOfRange);
+//     return c - '0';
+//   }
+//
+//   std::expected<int, absl::StatusCode> ParseNumber(std::string_view s) {
+//     int res = 0;
+//     for (char c : s) res = 10 * res + MTRY(ParseDigit(c));
+//     return res;
+//   }
+
+#ifndef MERROR_5EDA97_DOMAIN_EXPECTED_H_
+#define MERROR_5EDA97_DOMAIN_EXPECTED_H_
+
+#include <expected>
+#include <type_traits>
+#include <utility>
+
+#include "merror/domain/base.h"
+#include "merror/domain/method_hooks.h"
+#include "merror/domain/return.h"
+
+namespace merror {
+
+namespace internal_expected {
+
+template <class Exp>
+struct Acceptor {
+  bool IsError() const { return !exp.has_value(); }
+  decltype(*std::declval<Exp>()) GetValue() && {
+    return *std::forward<Exp>(exp);
+  }
+  const typename std::decay_t<Exp>::error_type& GetCulprit() && {
+    return exp.error();
+  }
+  Exp&& exp;
+};
+
+template <class T, class E>
+struct VerifyAcceptor {
+  bool IsError() const { return !exp.has_value(); }
+  const E& GetCulprit() const { return exp.error(); }
+  const std::expected<T, E>& exp;
+};
+
+template <class Base>
+struct AcceptExpected : Hook<Base> {
+  using Hook<Base>::MVerify;
+  using Hook<Base>::MTry;
+
+  template <class R, class T, class E>
+  VerifyAcceptor<T, E> MVerify(Ref<R, std::expected<T, E>> val) const {
+    return {val.Get()};
+  }
+
+  template <class R, class T, class E>
+  Acceptor<R> MTry(Ref<R, std::expected<T, E>> val) const {
+    return {val.Forward()};
+  }
+};
+
+template <class Base>
+struct MakeExpected : Hook<Base> {
+  using Hook<Base>::MakeMError;
+
+  template <class T, class E, class Culprit>
+  std::expected<T, E> MakeMError(ResultType<std::expected<T, E>>,
+                                 const Culprit& culprit) const {
+    return std::unexpected<E>(
+        this->derived().MakeError(ResultType<E>(), culprit));
+  }
+
+  template <class E, class Culprit>
+  std::unexpected<E> MakeMError(ResultType<std::unexpected<E>>,
+                                const Culprit& culprit) const {
+    return std::unexpected<E>(
+        this->derived().MakeError(ResultType<E>(), culprit));
+  }
+};
+
+}  // namespace internal_expected
+
+// Error domain extension that enables MTRY() and MVERIFY() to accept
+// std::expected<T, E> as an argument.
+using AcceptExpected = Policy<internal_expected::AcceptExpected>;
+
+// Error domain extension that enables merror macros to return
+// std::expected<T, E> and std::unexpected<E> on error.
+using MakeExpected = Builder<internal_expected::MakeExpected>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_EXPECTED_H_
@@ -0,0 +1,133 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "merror/domain/expected.h"
+
+#include <expected>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/domain/error_passthrough.h"
+#include "merror/domain/return.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::absl::StatusCode;
+using ::std::expected;
+using ::std::unexpected;
+
+enum class Err { kBad, kWorse };
+
+constexpr auto MErrorDomain = EmptyDomain().With(
+    ErrorPassthrough(), MethodHooks(), Return(), AcceptExpected(),
+    MakeExpected());
+
+TEST(Expected, ReturnExpected) {
+  bool passed;
+  auto F = [&](expected<int, Err> n) -> expected<std::string, Err> {
+    passed = false;
+    std::string res = std::to_string(MTRY(n));
+    passed = true;
+    return res;
+  };
+  EXPECT_EQ("42", F(42).value());
+  EXPECT_TRUE(passed);
+  EXPECT_EQ(Err::kWorse, F(unexpected(Err::kWorse)).error());
+  EXPECT_FALSE(passed);
+}
+
+TEST(Expected, ReturnUnexpected) {
+  auto F = [&](expected<int, Err> n) -> unexpected<Err> {
+    MTRY(n);
+    return unexpected(Err::kBad);
+  };
+  EXPECT_EQ(Err::kBad, F(1).error());
+  EXPECT_EQ(Err::kWorse, F(unexpected(Err::kWorse)).error());
+}
+
+TEST(Expected, Verify) {
+  auto F = [&](expected<void, Err> e) -> expected<int, Err> {
+    MVERIFY(e);
+    return 1;
+  };
+  EXPECT_EQ(1, F({}).value());
+  EXPECT_EQ(Err::kBad, F(unexpected(Err::kBad)).error());
+}
+
+TEST(Expected, MovesValue) {
+  auto F = [&](expected<std::unique_ptr<int>, Err> p) -> expected<int, Err> {
+    std::unique_ptr<int> q = MTRY(std::move(p));
+    return *q;
+  };
+  EXPECT_EQ(7, F(std::make_unique<int>(7)).value());
+  EXPECT_EQ(Err::kBad, F(unexpected(Err::kBad)).error());
+}
+
+TEST(Expected, StatusCode) {
+  constexpr auto MErrorDomain =
+      Default().With(AcceptExpected(), MakeExpected());
+  auto Digit = [&](char c) -> expected<int, StatusCode> {
+    MVERIFY(c >= '0' && c <= '9').ErrorCode(StatusCode::kOutOfRange);
+    return c - '0';
+  };
+  auto Number = [&](std::string_view s) -> expected<int, StatusCode> {
+    int res = 0;
+    for (char c : s) res = 10 * res + MTRY(Digit(c));
+    return res;
+  };
+  EXPECT_EQ(42, Number("42").value());
+  EXPECT_EQ(StatusCode::kOutOfRange, Number("4x").error());
+
+  auto Rewrite = [&](std::string_view s) -> expected<int, StatusCode> {
+    return MTRY(Number(s), _.ErrorCode(StatusCode::kInvalidArgument));
+  };
+  EXPECT_EQ(StatusCode::kInvalidArgument, Rewrite("4x").error());
+
+  auto FromStatus = [&](absl::Status s) -> expected<void, StatusCode> {
+    MVERIFY(s);
+    return {};
+  };
+  EXPECT_TRUE(FromStatus(absl::OkStatus()).has_value());
+  EXPECT_EQ(StatusCode::kNotFound,
+            FromStatus(absl::NotFoundError("")).error());
+
+  auto WithDefault = [&](bool b) -> expected<void, StatusCode> {
+    MERROR_DOMAIN().DefaultErrorCode(StatusCode::kInternal);
+    MVERIFY(b);
+    return {};
+  };
+  EXPECT_EQ(StatusCode::kInternal, WithDefault(false).error());
+}
+
+TEST(Expected, StatusFromExpected) {
+  constexpr auto MErrorDomain =
+      Default().With(AcceptExpected(), MakeExpected());
+  auto F = [&](expected<int, StatusCode> n) -> absl::Status {
+    MTRY(n);
+    return absl::OkStatus();
+  };
+  EXPECT_TRUE(F(1).ok());
+  EXPECT_EQ(StatusCode::kAborted, F(unexpected(StatusCode::kAborted)).code());
+}
+
+}  // namespace
+}  // namespace merror
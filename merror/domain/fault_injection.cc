@@ -0,0 +1,175 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "merror/domain/fault_injection.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+
+namespace merror {
+namespace internal_fault_injection {
+
+std::atomic<bool> armed{false};
+
+namespace {
+
+struct Fault {
+  std::string file;
+  int line;
+  double probability;
+  absl::StatusCode code;
+};
+
+struct Table {
+  // Unique among the tables of the process. Never zero.
+  uint32_t generation;
+  std::vector<Fault> faults;
+};
+
+// Writers serialize on the mutex and publish a new immutable table. Tables are
+// never freed, so readers only load the pointer, without locks or reference
+// counts. Faults are set rarely, by hand or by a load test, so the leak is
+// small.
+std::mutex& WriterMutex() {
+  static auto* mu = new std::mutex;
+  return *mu;
+}
+
+std::atomic<const Table*> current{nullptr};
+std::atomic<uint32_t> next_generation{1};
+
+void Publish(std::vector<Fault> faults) {
+  const Table* table = nullptr;
+  if (!faults.empty()) {
+    table = new Table{next_generation.fetch_add(1, std::memory_order_relaxed),
+                      std::move(faults)};
+  }
+  armed.store(table != nullptr, std::memory_order_relaxed);
+  current.store(table, std::memory_order_release);
+}
+
+// Returns a copy of the faults of the current table for modification.
+std::vector<Fault> CopyFaults() {
+  const Table* table = current.load(std::memory_order_acquire);
+  return table ? table->faults : std::vector<Fault>();
+}
+
+// `site` is `__FILE__`. `file` is the user-specified name.
+bool Matches(std::string_view site, std::string_view file) {
+  if (site.size() < file.size()) return false;
+  size_t pos = site.size() - file.size();
+  return site.substr(pos) == file && (pos == 0 || site[pos - 1] == '/');
+}
+
+// Returns a random number in [0, 1).
+double Random() {
+  // xorshift64*. The state is seeded from its own address, which is distinct
+  // for every thread.
+  thread_local uint64_t state = 0;
+  if (state == 0) state = reinterpret_cast<uintptr_t>(&state) | 1;
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return ((state * 0x2545F4914F6CDD1Dull) >> 11) * 0x1.0p-53;
+}
+
+thread_local absl::StatusCode injected = absl::StatusCode::kOk;
+
+// Returns the index plus one of the fault of `file:line` in the table, or zero
+// if there is none. A fault for the specific line takes precedence over the
+// one for the whole file.
+uint32_t Resolve(const Table& table, const char* file, int line) {
+  uint32_t res = 0;
+  for (uint32_t i = 0; i != table.faults.size(); ++i) {
+    const Fault& f = table.faults[i];
+    if ((f.line == line || (f.line == 0 && res == 0)) &&
+        Matches(file, f.file)) {
+      res = i + 1;
+      if (f.line == line) break;
+    }
+  }
+  return res;
+}
+
+}  // namespace
+
+bool Inject(const char* file, int line, std::atomic<uint64_t>& site_fault) {
+  const Table* table = current.load(std::memory_order_acquire);
+  if (!table) return false;
+  uint64_t cached = site_fault.load(std::memory_order_relaxed);
+  uint32_t index;
+  if (cached >> 32 == table->generation) {
+    index = static_cast<uint32_t>(cached);
+  } else {
+    index = Resolve(*table, file, line);
+    site_fault.store(uint64_t{table->generation} << 32 | index,
+                     std::memory_order_relaxed);
+  }
+  if (index == 0) return false;
+  const Fault& fault = table->faults[index - 1];
+  if (Random() >= fault.probability) return false;
+  injected = fault.code;
+  return true;
+}
+
+absl::StatusCode InjectedCode() { return injected; }
+
+void Reset() { injected = absl::StatusCode::kOk; }
+
+}  // namespace internal_fault_injection
+
+void SetFault(std::string_view file, int line, double probability,
+              absl::StatusCode code) {
+  using internal_fault_injection::Fault;
+  // The fault must be an error.
+  if (code == absl::StatusCode::kOk) code = absl::StatusCode::kUnknown;
+  std::lock_guard<std::mutex> lock(internal_fault_injection::WriterMutex());
+  std::vector<Fault> faults = internal_fault_injection::CopyFaults();
+  auto it = std::find_if(faults.begin(), faults.end(), [&](const Fault& f) {
+    return f.file == file && f.line == line;
+  });
+  if (it == faults.end()) it = faults.insert(faults.end(), Fault());
+  *it = Fault{std::string(file), line, probability, code};
+  internal_fault_injection::Publish(std::move(faults));
+}
+
+void ClearFault(std::string_view file, int line) {
+  using internal_fault_injection::Fault;
+  std::lock_guard<std::mutex> lock(internal_fault_injection::WriterMutex());
+  std::vector<Fault> faults = internal_fault_injection::CopyFaults();
+  faults.erase(std::remove_if(faults.begin(), faults.end(),
+                              [&](const Fault& f) {
+                                return f.file == file && f.line == line;
+                              }),
+               faults.end());
+  internal_fault_injection::Publish(std::move(faults));
+}
+
+void ClearFaults() {
+  std::lock_guard<std::mutex> lock(internal_fault_injection::WriterMutex());
+  internal_fault_injection::Publish({});
+}
+
+}  // namespace merror
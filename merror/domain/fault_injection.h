@@ -0,0 +1,161 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `FaultInjection`. This error domain extension allows forcing
+// failures of `MVERIFY()` and `MTRY()` at chosen sites at run time, without
+// changing the code. It's meant for exercising the real failure paths under
+// production-like load.
+//
+//   // Add the extension last, so that it can see the errors made by the
+//   // others.
+//   const auto MErrorDomain =
+//       merror::Default().With(merror::FaultInjection());
+//
+//   Status Handle(const Request& req) {
+//     MTRY(Authorize(req));
+//     ...
+//   }
+//
+//   // In a load test or an admin endpoint: fail 10% of the `MTRY()` calls on
+//   // line 42 of server/handler.cc with UNAVAILABLE.
+//   merror::SetFault("server/handler.cc", 42, 0.1,
+//                    absl::StatusCode::kUnavailable);
+//   ...
+//   merror::ClearFaults();
+//
+// A site is identified by the file name, as in `__FILE__` or any suffix of it
+// that starts after a '/', and the line number. Line number 0 matches every
+// line of the file.
+//
+// When a fault is injected, the macro behaves as if its argument was an error.
+// The error is made with the usual builder, annotations and observers. The
+// culprit passed to `MakeError()` is `absl::Status` with the injected code and
+// a description of the site, so the domain must be able to make errors from
+// it. Builder methods such as `ErrorCode()` override the injected code just
+// like they override the code of a real error. The successful argument isn't
+// asked for its culprit. Instead, observers and `GetErrorBuilder()` see
+// `absl::Status` with the injected code in `MTRY()`, and the same status
+// converted to the usual culprit type in `MVERIFY()`. Culprits that are empty
+// tags, such as the one of `MVERIFY(bool)`, are value-initialized. Faults are
+// never injected into `MVERIFY()` with other culprits, for example
+// `MVERIFY(expected)` or `MVERIFY(errno_value)`.
+//
+// While no faults are set, the cost of the extension is a single relaxed
+// atomic load per successful `MVERIFY()` and `MTRY()`. While there are faults,
+// each site looks up its fault once per change of the faults and caches it, so
+// the macros don't contend with each other. Faults can be set and cleared
+// concurrently with the macros.
+
+#ifndef MERROR_5EDA97_DOMAIN_FAULT_INJECTION_H_
+#define MERROR_5EDA97_DOMAIN_FAULT_INJECTION_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string_view>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "merror/domain/base.h"
+#include "merror/domain/observer.h"
+#include "merror/domain/return.h"
+
+namespace merror {
+
+// Makes `MVERIFY()` and `MTRY()` at `file:line` fail with the specified
+// probability and error code. Replaces the previous fault at the same site.
+// `kOk` is replaced with `kUnknown`, since the fault must be an error.
+void SetFault(std::string_view file, int line, double probability,
+              absl::StatusCode code);
+
+// Removes the fault set at `file:line`, if any.
+void ClearFault(std::string_view file, int line);
+
+// Removes all faults.
+void ClearFaults();
+
+namespace internal_fault_injection {
+
+// True if there is at least one fault.
+extern std::atomic<bool> armed;
+
+// The fault of a site, resolved against the table of faults with the
+// generation in the high 32 bits. The low 32 bits are the index of the fault
+// in the table plus one, or zero if the site has no fault.
+template <class Site>
+inline std::atomic<uint64_t> site_fault{0};
+
+// Returns true and remembers `code` of the fault for the current thread if a
+// fault should be injected at `file:line`. `site_fault` is the cache of the
+// site.
+bool Inject(const char* file, int line, std::atomic<uint64_t>& site_fault);
+
+// Returns the code remembered by `Inject()`, or `kOk` if there is none.
+absl::StatusCode InjectedCode();
+
+// Forgets the code remembered by `Inject()`.
+void Reset();
+
+template <class Base>
+struct Policy : Base {
+  template <class Site>
+  ABSL_ATTRIBUTE_ALWAYS_INLINE bool ShouldInjectFault(Site site) const {
+    if (ABSL_PREDICT_TRUE(!armed.load(std::memory_order_relaxed))) {
+      return false;
+    }
+    return Inject(site.file, site.line, site_fault<Site>);
+  }
+
+  // Called by the macros after `ShouldInjectFault()` has returned true.
+  absl::Status InjectedCulprit() const {
+    return absl::Status(InjectedCode(), "Injected fault");
+  }
+};
+
+template <class Base>
+struct Builder : Observer<Base> {
+  template <class R, class Culprit>
+  R MakeError(ResultType<R> r, const Culprit& culprit) const {
+    absl::StatusCode code = InjectedCode();
+    if (ABSL_PREDICT_FALSE(code != absl::StatusCode::kOk)) {
+      const auto& ctx = this->context();
+      return Base::MakeError(
+          r, absl::Status(code, absl::StrCat(ctx.file, ":", ctx.line, ": ",
+                                             ctx.macro_str, "(", ctx.args_str,
+                                             ")\nInjected fault")));
+    }
+    return Base::MakeError(r, culprit);
+  }
+
+  // Unlike other observers, resets the state after the base class, since the
+  // observers there may call `MakeError()`.
+  template <class RetVal>
+  void ObserveRetVal(const RetVal& ret_val) {
+    Observer<Base>::ObserveRetVal(ret_val);
+    Reset();
+  }
+};
+
+}  // namespace internal_fault_injection
+
+// Error domain extension that enables fault injection. See comments at the top
+// of the file for details.
+using FaultInjection = Domain<internal_fault_injection::Policy,
+                              internal_fault_injection::Builder>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_FAULT_INJECTION_H_
@@ -0,0 +1,164 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "merror/domain/fault_injection.h"
+
+#include <expected>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/domain/expected.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::absl::StatusCode;
+
+constexpr auto MErrorDomain =
+    Default().DefaultErrorCode(StatusCode::kUnknown).With(FaultInjection());
+
+constexpr char kFile[] = "merror/domain/fault_injection_test.cc";
+
+const int kVerifyLine = __LINE__ + 2;
+absl::Status Verify(bool b) {
+  MVERIFY(b).ErrorCode(StatusCode::kInvalidArgument);
+  return absl::OkStatus();
+}
+
+const int kTryLine = __LINE__ + 2;
+absl::StatusOr<int> Try(absl::StatusOr<int> x) {
+  return MTRY(x) + 1;
+}
+
+const int kVerifyCodeLine = __LINE__ + 2;
+absl::Status VerifyCode(absl::Status s) {
+  MVERIFY(s);
+  return absl::OkStatus();
+}
+
+// The acceptors of `std::expected` may be asked for the culprit only if it
+// holds an error.
+const int kTryExpectedLine = __LINE__ + 5;
+absl::StatusOr<int> TryExpected(std::expected<int, std::string> x) {
+  constexpr auto MErrorDomain = Default()
+                                    .DefaultErrorCode(StatusCode::kUnknown)
+                                    .With(AcceptExpected(), FaultInjection());
+  return MTRY(x) + 1;
+}
+
+const int kVerifyExpectedLine = __LINE__ + 5;
+absl::Status VerifyExpected(std::expected<int, std::string> x) {
+  constexpr auto MErrorDomain = Default()
+                                    .DefaultErrorCode(StatusCode::kUnknown)
+                                    .With(AcceptExpected(), FaultInjection());
+  MVERIFY(x);
+  return absl::OkStatus();
+}
+
+class FaultInjectionTest : public ::testing::Test {
+ protected:
+  ~FaultInjectionTest() override { ClearFaults(); }
+};
+
+TEST_F(FaultInjectionTest, NoFaults) {
+  EXPECT_TRUE(Verify(true).ok());
+  EXPECT_EQ(StatusCode::kInvalidArgument, Verify(false).code());
+  EXPECT_EQ(2, *Try(1));
+  EXPECT_EQ(StatusCode::kNotFound,
+            Try(absl::NotFoundError("")).status().code());
+}
+
+TEST_F(FaultInjectionTest, Try) {
+  SetFault(kFile, kTryLine, 1, StatusCode::kUnavailable);
+  absl::Status s = Try(1).status();
+  EXPECT_EQ(StatusCode::kUnavailable, s.code());
+  EXPECT_THAT(std::string(s.message()), ::testing::HasSubstr("MTRY(x)"));
+  // Other sites aren't affected.
+  EXPECT_TRUE(Verify(true).ok());
+  ClearFault(kFile, kTryLine);
+  EXPECT_EQ(2, *Try(1));
+}
+
+TEST_F(FaultInjectionTest, Verify) {
+  SetFault(kFile, kVerifyCodeLine, 1, StatusCode::kDeadlineExceeded);
+  EXPECT_EQ(StatusCode::kDeadlineExceeded,
+            VerifyCode(absl::OkStatus()).code());
+  // Real errors keep their codes.
+  EXPECT_EQ(StatusCode::kAborted, VerifyCode(absl::AbortedError("")).code());
+}
+
+TEST_F(FaultInjectionTest, Expected) {
+  SetFault(kFile, kTryExpectedLine, 1, StatusCode::kUnavailable);
+  SetFault(kFile, kVerifyExpectedLine, 1, StatusCode::kUnavailable);
+  absl::Status s = TryExpected(1).status();
+  EXPECT_EQ(StatusCode::kUnavailable, s.code());
+  EXPECT_THAT(std::string(s.message()), ::testing::HasSubstr("MTRY(x)"));
+  // There is no culprit to give to `MVERIFY()`, so it isn't injected.
+  EXPECT_TRUE(VerifyExpected(1).ok());
+  EXPECT_EQ(StatusCode::kUnknown,
+            VerifyExpected(std::unexpected("bad")).code());
+}
+
+TEST_F(FaultInjectionTest, BuilderOverridesCode) {
+  SetFault(kFile, kVerifyLine, 1, StatusCode::kUnavailable);
+  EXPECT_EQ(StatusCode::kInvalidArgument, Verify(true).code());
+}
+
+TEST_F(FaultInjectionTest, WholeFile) {
+  SetFault("fault_injection_test.cc", 0, 1, StatusCode::kInternal);
+  SetFault(kFile, kTryLine, 1, StatusCode::kUnavailable);
+  EXPECT_EQ(StatusCode::kInternal, VerifyCode(absl::OkStatus()).code());
+  EXPECT_EQ(StatusCode::kUnavailable, Try(1).status().code());
+  // Not a suffix that starts after a '/'.
+  ClearFaults();
+  SetFault("injection_test.cc", 0, 1, StatusCode::kInternal);
+  EXPECT_TRUE(VerifyCode(absl::OkStatus()).ok());
+}
+
+TEST_F(FaultInjectionTest, ChangedFault) {
+  SetFault(kFile, kTryLine, 1, StatusCode::kUnavailable);
+  EXPECT_EQ(StatusCode::kUnavailable, Try(1).status().code());
+  // The site looks up its fault again after every change.
+  SetFault(kFile, kTryLine, 1, StatusCode::kAborted);
+  EXPECT_EQ(StatusCode::kAborted, Try(1).status().code());
+  SetFault(kFile, kVerifyCodeLine, 1, StatusCode::kInternal);
+  EXPECT_EQ(StatusCode::kAborted, Try(1).status().code());
+  ClearFault(kFile, kTryLine);
+  EXPECT_EQ(2, *Try(1));
+  EXPECT_EQ(StatusCode::kInternal, VerifyCode(absl::OkStatus()).code());
+}
+
+TEST_F(FaultInjectionTest, OkCode) {
+  SetFault(kFile, kTryLine, 1, StatusCode::kOk);
+  EXPECT_EQ(StatusCode::kUnknown, Try(1).status().code());
+}
+
+TEST_F(FaultInjectionTest, Probability) {
+  SetFault(kFile, kTryLine, 0, StatusCode::kUnavailable);
+  for (int i = 0; i != 1000; ++i) ASSERT_TRUE(Try(i).ok());
+  SetFault(kFile, kTryLine, 0.5, StatusCode::kUnavailable);
+  int failed = 0;
+  for (int i = 0; i != 10000; ++i) failed += !Try(i).ok();
+  EXPECT_GT(failed, 4000);
+  EXPECT_LT(failed, 6000);
+}
+
+}  // namespace
+}  // namespace merror
@@ -20,9 +20,12 @@
 
 #include <stddef.h>
 
+#include <ios>
+#include <memory>
 #include <ostream>
 #include <streambuf>
 #include <string>
+#include <vector>
 
 namespace merror {
 namespace internal {
@@ -40,6 +43,23 @@ class IndentingStream : private std::basic_streambuf<char>,
   // Indentation happens when writing the first character of a non-empty line.
   void indent(size_t n) { indent_ = n; }
 
+  // Brings the stream to the state of a newly constructed one, except that the
+  // capacity of the content is kept if it isn't too large. The locale isn't
+  // reset.
+  void Reset() {
+    if (s_.capacity() > kMaxRetainedCapacity) {
+      std::string().swap(s_);
+    } else {
+      s_.clear();
+    }
+    indent_ = 0;
+    std::ostream::clear();
+    flags(std::ios_base::skipws | std::ios_base::dec);
+    precision(6);
+    width(0);
+    fill(' ');
+  }
+
  private:
   using Buf = std::basic_streambuf<char>;
 
@@ -49,7 +69,11 @@ class IndentingStream : private std::basic_streambuf<char>,
   }
 
   std::streamsize xsputn(const char* s, std::streamsize n) override {
-    for (const char* end = s + n; s != end; ++s) append(*s);
+    if (indent_ == 0) {
+      s_.append(s, n);
+    } else {
+      for (const char* end = s + n; s != end; ++s) append(*s);
+    }
     return n;
   }
 
@@ -61,10 +85,49 @@ class IndentingStream : private std::basic_streambuf<char>,
     s_.push_back(c);
   }
 
+  static constexpr size_t kMaxRetainedCapacity = 64 << 10;
+
   std::string s_;
   size_t indent_ = 0;
 };
 
+// Borrows an empty `IndentingStream` from a per-thread pool for the duration of
+// its scope. Streams are reset and returned to the pool on destruction, so
+// formatting on the error path reuses their buffers instead of allocating.
+// Scratch streams may be nested and moved.
+class ScratchStream {
+ public:
+  ScratchStream() {
+    auto& pool = Pool();
+    if (pool.empty()) {
+      strm_.reset(new IndentingStream);
+    } else {
+      strm_ = std::move(pool.back());
+      pool.pop_back();
+    }
+  }
+
+  ~ScratchStream() {
+    if (!strm_) return;
+    strm_->Reset();
+    Pool().push_back(std::move(strm_));
+  }
+
+  ScratchStream(ScratchStream&&) = default;
+  ScratchStream& operator=(ScratchStream&&) = delete;
+
+  IndentingStream& operator*() const { return *strm_; }
+  IndentingStream* operator->() const { return strm_.get(); }
+
+ private:
+  static std::vector<std::unique_ptr<IndentingStream>>& Pool() {
+    static thread_local std::vector<std::unique_ptr<IndentingStream>> pool;
+    return pool;
+  }
+
+  std::unique_ptr<IndentingStream> strm_;
+};
+
 }  // namespace internal
 }  // namespace merror
 
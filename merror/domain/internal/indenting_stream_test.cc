@@ -15,6 +15,9 @@
 
 #include "merror/domain/internal/indenting_stream.h"
 
+#include <ios>
+#include <string>
+
 #include "gtest/gtest.h"
 
 namespace merror {
@@ -117,6 +120,41 @@ TEST(IndentingStream, FromUnfinishedLine) {
   }
 }
 
+TEST(IndentingStream, Reset) {
+  IndentingStream strm;
+  strm.indent(2);
+  strm << std::hex << std::uppercase << 255 << "\nabc";
+  strm.Reset();
+  EXPECT_EQ("", strm.str());
+  strm << 255 << "\nabc";
+  EXPECT_EQ("255\nabc", strm.str());
+}
+
+TEST(ScratchStream, Reuse) {
+  const IndentingStream* p;
+  {
+    ScratchStream strm;
+    p = &*strm;
+    *strm << std::string(1000, 'x');
+  }
+  ScratchStream strm;
+  EXPECT_TRUE(p == &*strm);
+  EXPECT_EQ("", strm->str());
+  EXPECT_GE(strm->str().capacity(), 1000);
+}
+
+TEST(ScratchStream, Nested) {
+  ScratchStream a;
+  *a << "a";
+  {
+    ScratchStream b;
+    EXPECT_TRUE(&*a != &*b);
+    *b << "b";
+    EXPECT_EQ("b", b->str());
+  }
+  EXPECT_EQ("a", a->str());
+}
+
 }  // namespace
 }  // namespace internal
 }  // namespace merror
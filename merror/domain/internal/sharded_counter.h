@@ -0,0 +1,122 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `ShardedCounter`, a counter split into cache-line-sized shards
+// indexed by the CPU the calling thread runs on. When a single site fails on
+// all cores, incrementing a single atomic bounces its cache line between them;
+// with a shard per CPU every core mostly writes to its own line.
+//
+// The CPU is obtained with `sched_getcpu()`, which recent versions of glibc
+// serve from the rseq area without a system call. Where it's unavailable, each
+// thread sticks to a shard chosen by hashing its ID.
+//
+// A thread may migrate to another CPU between looking up its shard and
+// incrementing it, so two CPUs may occasionally share a shard. Increments are
+// atomic, so this affects performance but not correctness.
+
+#ifndef MERROR_5EDA97_DOMAIN_INTERNAL_SHARDED_COUNTER_H_
+#define MERROR_5EDA97_DOMAIN_INTERNAL_SHARDED_COUNTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace merror {
+namespace internal {
+
+// Returns the index of the CPU the calling thread is running on. May be
+// stale by the time it's used.
+inline unsigned CurrentCpu() {
+#if defined(__linux__)
+  int cpu = sched_getcpu();
+  if (cpu >= 0) return static_cast<unsigned>(cpu);
+#endif
+  static thread_local unsigned id = static_cast<unsigned>(
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+  return id;
+}
+
+class ShardedCounter {
+ public:
+  // The number of shards is the number of CPUs rounded up to a power of two
+  // and capped at `kMaxShards`.
+  static constexpr size_t kMaxShards = 64;
+
+  ShardedCounter() : mask_(NumShards() - 1), shards_(new Shard[mask_ + 1]) {}
+
+  ShardedCounter(const ShardedCounter&) = delete;
+  ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+  // Adds `n` to the shard of the current CPU. Returns the value of the shard
+  // before the addition.
+  int64_t Add(int64_t n = 1) {
+    return shards_[CurrentCpu() & mask_].value.fetch_add(
+        n, std::memory_order_relaxed);
+  }
+
+  // The sum of all shards. Not a snapshot: concurrent additions may or may not
+  // be included.
+  int64_t Sum() const {
+    int64_t sum = 0;
+    for (size_t i = 0; i <= mask_; ++i) {
+      sum += shards_[i].value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  // Resets all shards to zero and returns the sum of their values. Additions
+  // that race with it are either returned or kept for the next call.
+  int64_t Take() {
+    int64_t sum = 0;
+    for (size_t i = 0; i <= mask_; ++i) {
+      if (shards_[i].value.load(std::memory_order_relaxed) != 0) {
+        sum += shards_[i].value.exchange(0, std::memory_order_relaxed);
+      }
+    }
+    return sum;
+  }
+
+  size_t num_shards() const { return mask_ + 1; }
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value{0};
+  };
+
+  static size_t NumShards() {
+    static const size_t n = [] {
+      size_t cpus = std::thread::hardware_concurrency();
+      size_t res = 1;
+      while (res < cpus && res < kMaxShards) res *= 2;
+      return res;
+    }();
+    return n;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace internal
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_INTERNAL_SHARDED_COUNTER_H_
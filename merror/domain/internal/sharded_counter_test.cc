@@ -0,0 +1,68 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/internal/sharded_counter.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace merror {
+namespace internal {
+namespace {
+
+TEST(ShardedCounter, NumShards) {
+  ShardedCounter c;
+  size_t n = c.num_shards();
+  EXPECT_GE(n, 1);
+  EXPECT_LE(n, ShardedCounter::kMaxShards);
+  EXPECT_EQ(0, n & (n - 1));
+}
+
+TEST(ShardedCounter, Sum) {
+  ShardedCounter c;
+  EXPECT_EQ(0, c.Sum());
+  c.Add();
+  c.Add(41);
+  EXPECT_EQ(42, c.Sum());
+  c.Add(-2);
+  EXPECT_EQ(40, c.Sum());
+}
+
+TEST(ShardedCounter, Take) {
+  ShardedCounter c;
+  EXPECT_EQ(0, c.Take());
+  c.Add(42);
+  EXPECT_EQ(42, c.Take());
+  EXPECT_EQ(0, c.Sum());
+  c.Add();
+  EXPECT_EQ(1, c.Take());
+}
+
+TEST(ShardedCounter, Concurrent) {
+  ShardedCounter c;
+  std::vector<std::thread> threads;
+  for (int i = 0; i != 8; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j != 10000; ++j) c.Add();
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  EXPECT_EQ(80000, c.Sum());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace merror
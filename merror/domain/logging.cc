@@ -21,15 +21,20 @@
 #include <algorithm>
 #include <atomic>
 #include <cctype>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <mutex>
+#include <string>
 #include <string_view>
 #include <tuple>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "merror/domain/internal/indenting_stream.h"
+#include "merror/domain/internal/sharded_counter.h"
 
 namespace merror {
 
@@ -37,12 +42,25 @@ class FirstN::Filter {
  public:
   static bool AlwaysTrue(const FirstN&) { return false; }
 
+  // Records are accepted by their index from `i_`. Once the first N records
+  // have been accepted, the rest are counted per CPU, so rejecting them
+  // doesn't bounce a shared cache line. The slow path moves these counts into
+  // `i_` before taking an index, which keeps the indices exact even if N
+  // differs between calls.
   bool Test(const FirstN& cfg) {
+    if (i_.load(std::memory_order_relaxed) >= cfg.n_) {
+      overflow_.Add();
+      return false;
+    }
+    if (int64_t rejected = overflow_.Take()) {
+      i_.fetch_add(rejected, std::memory_order_relaxed);
+    }
     return i_.fetch_add(1, std::memory_order_relaxed) < cfg.n_;
   }
 
  private:
   std::atomic<int64_t> i_{0};
+  internal::ShardedCounter overflow_;
 };
 
 class EveryN::Filter {
@@ -52,12 +70,12 @@ class EveryN::Filter {
   }
 
   bool Test(const EveryN& cfg) {
-    int64_t i = i_.fetch_add(1, std::memory_order_relaxed);
+    int64_t i = i_.Add();
     return cfg.n_ != 0 && i % cfg.n_ == 0;
   }
 
  private:
-  std::atomic<int64_t> i_{0};
+  internal::ShardedCounter i_;
 };
 
 class EveryPow2::Filter {
@@ -65,12 +83,12 @@ class EveryPow2::Filter {
   static bool AlwaysTrue(const EveryPow2&) { return false; }
 
   bool Test(const EveryPow2&) {
-    uint64_t i = i_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t i = i_.Add() + 1;
     return (i & (i - 1)) == 0;
   }
 
  private:
-  std::atomic<uint64_t> i_{1};
+  internal::ShardedCounter i_;
 };
 
 class Every::Filter {
@@ -140,6 +158,212 @@ void CerrLogger::Log(const char* file, int line, std::string_view msg) const {
   std::cerr << file << ":" << line << ": " << msg << std::endl;
 }
 
+namespace {
+
+// A site that exceeds the budget logs at least one in 2^kMaxShift records.
+constexpr uint32_t kMaxShift = 16;
+// The summary lists at most this many sites.
+constexpr size_t kMaxSummarySites = 20;
+constexpr int64_t kNanosPerSecond = 1000000000;
+
+int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Lock-free token bucket implemented as a generic cell rate algorithm: instead
+// of the number of tokens it stores the time at which the bucket will be full
+// again. It holds one second worth of tokens.
+class TokenBucket {
+ public:
+  // Zero means unlimited.
+  void SetRate(uint64_t per_second) {
+    rate_.store(per_second, std::memory_order_relaxed);
+    full_at_.store(0, std::memory_order_relaxed);
+  }
+
+  bool TryTake(uint64_t n, int64_t now) {
+    uint64_t rate = rate_.load(std::memory_order_relaxed);
+    if (rate == 0) return true;
+    // The cost is capped at the capacity of the bucket. Otherwise a request
+    // for more than one second worth of tokens could never be satisfied. Such
+    // a request is admitted when the bucket is full and drains it.
+    int64_t cost = static_cast<int64_t>(
+        std::min<uint64_t>({n, rate, kNanosPerSecond}) * kNanosPerSecond /
+        rate);
+    int64_t full_at = full_at_.load(std::memory_order_relaxed);
+    int64_t next;
+    do {
+      next = std::max(full_at, now) + cost;
+      if (next - now > kNanosPerSecond) return false;
+    } while (!full_at_.compare_exchange_weak(full_at, next,
+                                             std::memory_order_relaxed));
+    return true;
+  }
+
+ private:
+  std::atomic<uint64_t> rate_{0};
+  std::atomic<int64_t> full_at_{0};
+};
+
+TokenBucket records_bucket;
+TokenBucket bytes_bucket;
+std::atomic<int64_t> summary_period{0};
+std::atomic<int64_t> next_summary{0};
+// Registered sites.
+std::atomic<internal::LogSampling*> sites{nullptr};
+
+void Register(internal::LogSampling& site, const char* file, int line) {
+  if (site.registered.exchange(true, std::memory_order_relaxed)) return;
+  site.file = file;
+  site.line = line;
+  internal::LogSampling* head = sites.load(std::memory_order_relaxed);
+  do {
+    site.next = head;
+  } while (!sites.compare_exchange_weak(head, &site, std::memory_order_release,
+                                        std::memory_order_relaxed));
+}
+
+// Claims the once per second change of the sampling rate of the site.
+bool Adapt(internal::LogSampling& site, int64_t now) {
+  int64_t adapted_at = site.adapted_at.load(std::memory_order_relaxed);
+  return now - adapted_at >= kNanosPerSecond &&
+         site.adapted_at.compare_exchange_strong(adapted_at, now,
+                                                 std::memory_order_relaxed);
+}
+
+// Halves the sampling rate of the site, unless it has already changed within
+// the last second. A burst of rejections is the bucket being empty once, not
+// a reason to back off once per record.
+void Reject(internal::LogSampling& site, int64_t now) {
+  site.rejected.fetch_add(1, std::memory_order_relaxed);
+  site.rejected_at.store(now, std::memory_order_relaxed);
+  uint32_t shift = site.shift.load(std::memory_order_relaxed);
+  if (shift < kMaxShift && Adapt(site, now)) {
+    site.shift.compare_exchange_strong(shift, shift + 1,
+                                       std::memory_order_relaxed);
+  }
+}
+
+// Doubles the sampling rate of the site if it has gone a whole second without
+// rejections and without a change of the rate.
+void Recover(internal::LogSampling& site, uint32_t& shift, int64_t now) {
+  if (now - site.rejected_at.load(std::memory_order_relaxed) <
+          kNanosPerSecond ||
+      !Adapt(site, now)) {
+    return;
+  }
+  if (site.shift.compare_exchange_strong(shift, shift - 1,
+                                         std::memory_order_relaxed)) {
+    --shift;
+  }
+}
+
+}  // namespace
+}  // namespace internal_logging
+
+void SetLogBudget(const LogBudget& budget) {
+  using internal_logging::budget_enabled;
+  budget_enabled.store(false, std::memory_order_relaxed);
+  internal_logging::records_bucket.SetRate(budget.records_per_second);
+  internal_logging::bytes_bucket.SetRate(budget.bytes_per_second);
+  int64_t period = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       budget.summary_period)
+                       .count();
+  internal_logging::summary_period.store(period, std::memory_order_relaxed);
+  internal_logging::next_summary.store(internal_logging::NowNanos() + period,
+                                       std::memory_order_relaxed);
+  for (internal::LogSampling* site =
+           internal_logging::sites.load(std::memory_order_acquire);
+       site; site = site->next) {
+    site->shift.store(0, std::memory_order_relaxed);
+    site->adapted_at.store(0, std::memory_order_relaxed);
+    site->rejected_at.store(0, std::memory_order_relaxed);
+    site->sampled_out.store(0, std::memory_order_relaxed);
+    site->rejected.store(0, std::memory_order_relaxed);
+  }
+  budget_enabled.store(
+      budget.records_per_second != 0 || budget.bytes_per_second != 0,
+      std::memory_order_relaxed);
+}
+
+namespace internal_logging {
+
+bool AdmitRecord(internal::LogSampling& site, const char* file, int line) {
+  if (!site.registered.load(std::memory_order_relaxed)) {
+    Register(site, file, line);
+  }
+  int64_t now = NowNanos();
+  uint32_t shift = site.shift.load(std::memory_order_relaxed);
+  if (shift != 0) Recover(site, shift, now);
+  if (shift != 0) {
+    uint32_t i = site.counter.fetch_add(1, std::memory_order_relaxed);
+    if ((i & ((uint32_t{1} << shift) - 1)) != 0) {
+      site.sampled_out.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  if (!records_bucket.TryTake(1, now)) {
+    Reject(site, now);
+    return false;
+  }
+  return true;
+}
+
+bool AdmitBytes(internal::LogSampling& site, size_t bytes) {
+  int64_t now = NowNanos();
+  if (!bytes_bucket.TryTake(bytes, now)) {
+    Reject(site, now);
+    return false;
+  }
+  return true;
+}
+
+bool TakeBudgetSummary(std::string* summary) {
+  int64_t now = NowNanos();
+  int64_t next = next_summary.load(std::memory_order_relaxed);
+  if (now < next) return false;
+  int64_t period = summary_period.load(std::memory_order_relaxed);
+  if (!next_summary.compare_exchange_strong(next, now + period,
+                                            std::memory_order_relaxed)) {
+    return false;
+  }
+  struct Drops {
+    const internal::LogSampling* site;
+    uint64_t dropped;
+  };
+  std::vector<Drops> drops;
+  uint64_t total = 0;
+  for (internal::LogSampling* site = sites.load(std::memory_order_acquire);
+       site; site = site->next) {
+    uint64_t dropped = site->rejected.exchange(0, std::memory_order_relaxed) +
+                       site->sampled_out.exchange(0, std::memory_order_relaxed);
+    if (dropped == 0) continue;
+    drops.push_back({site, dropped});
+    total += dropped;
+  }
+  if (drops.empty()) return false;
+  std::sort(drops.begin(), drops.end(), [](const Drops& a, const Drops& b) {
+    return a.dropped > b.dropped;
+  });
+  internal::ScratchStream scratch;
+  internal::IndentingStream& strm = *scratch;
+  strm << "Log budget exceeded: dropped " << total << " records from "
+       << drops.size() << " sites";
+  for (size_t i = 0; i != std::min(drops.size(), kMaxSummarySites); ++i) {
+    const internal::LogSampling& site = *drops[i].site;
+    strm << "\n  " << site.file << ':' << site.line << ": "
+         << drops[i].dropped << " dropped, logging 1 in "
+         << (uint64_t{1} << site.shift.load(std::memory_order_relaxed));
+  }
+  if (drops.size() > kMaxSummarySites) {
+    strm << "\n  ... and " << drops.size() - kMaxSummarySites << " more sites";
+  }
+  *summary = strm.str();
+  return true;
+}
+
 template <class Filter>
 bool ShouldLog(const Filter& filter, uintptr_t location_id) {
   if (Filter::Filter::AlwaysTrue(filter)) {
@@ -190,12 +414,12 @@ template bool ShouldLog<EveryN>(const EveryN&, uintptr_t);
 template bool ShouldLog<EveryPow2>(const EveryPow2&, uintptr_t);
 template bool ShouldLog<Every>(const Every&, uintptr_t);
 
-std::string FormatMessage(
-    Macro macro, const char* macro_str, const char* args_str,
-    RelationalExpression* rel_expr,
-    const std::function<void(std::ostream*)>& print_culprit,
-    std::string_view policy_description, std::string_view builder_description) {
-  internal::IndentingStream strm;
+void FormatMessage(Macro macro, const char* macro_str, const char* args_str,
+                   RelationalExpression* rel_expr, std::ptrdiff_t index,
+                   CulpritPrinter print_culprit,
+                   std::string_view policy_description,
+                   std::string_view builder_description,
+                   internal::IndentingStream& strm) {
   auto WritePrefix = [&](std::string_view prefix) {
     assert(!strm.str().empty());
     strm.indent(0);
@@ -222,11 +446,14 @@ std::string FormatMessage(
     strm << macro_str << '(' << rel_expr->left << ' ' << rel_expr->op << ' '
          << rel_expr->right << ')';
   }
+  if (index >= 0) {
+    WritePrefix("Index: ");
+    strm << index;
+  }
   if (print_culprit) {
     WritePrefix("Culprit: ");
     print_culprit(&strm);
   }
-  return std::move(strm.str());
 }
 
 }  // namespace internal_logging
@@ -56,6 +56,11 @@
 //  * `EveryPow2()` accepts log records with power-of-two one-based indices.
 //    Similar to the `LOG_EVERY_POW2` macro.
 //
+// `EveryN` and `EveryPow2` count records per CPU, so that a site failing on
+// all cores doesn't bounce a shared counter between them. Records from a
+// single CPU are filtered exactly as described. With several CPUs each one
+// accepts every nth of its own records.
+//
 //  * `Every(absl::Duration d)` accepts one log record every `d` starting from
 //    the first. Similar to the `LOG_EVERY_N_SEC` macro.
 //
@@ -101,6 +106,29 @@
 // `*Log()`. Again the last one wins: `Log(WARNING)`. The end result is
 // equivalent to `Log(WARNING, Every(absl::Seconds(60)))`.
 //
+// Filters are per site, so they can't stop a thousand distinct sites from
+// each logging once per second during an outage. `SetLogBudget()` sets a
+// process-wide limit on the number of records and bytes logged per second,
+// shared by all sites. Records over the budget are dropped. When records of a
+// site are dropped for exceeding the budget, the site starts logging half as
+// many of the records that pass its filter, down to one in 65536. Once a
+// second passes without such drops, the site doubles its rate again. The rate
+// of a site changes at most once per second.
+// Every summary period, if anything has been dropped, a summary with the
+// number of dropped records per site is logged.
+//
+//   int main() {
+//     merror::LogBudget budget;
+//     budget.bytes_per_second = 1 << 20;
+//     budget.records_per_second = 1000;
+//     merror::SetLogBudget(budget);
+//     ...
+//   }
+//
+// The budget is enforced by lock-free token buckets that allow bursts of up to
+// one second worth of budget. Without a budget the only cost is a relaxed load
+// per logged error.
+//
 // TODO(romanp): support custom filters.
 // TODO(romanp): support custom loggers.
 // TODO(romanp): support custom formatters.
@@ -109,7 +137,9 @@
 #define MERROR_5EDA97_DOMAIN_LOGGING_H_
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <iosfwd>
@@ -122,6 +152,8 @@
 #include "merror/domain/base.h"
 #include "merror/domain/defer.h"
 #include "merror/domain/description.h"
+#include "merror/domain/error_stats.h"
+#include "merror/domain/internal/indenting_stream.h"
 #include "merror/domain/observer.h"
 #include "merror/domain/print.h"
 
@@ -130,6 +162,21 @@ namespace merror {
 using Duration = std::chrono::milliseconds;
 using Time = std::chrono::time_point<std::chrono::system_clock>;
 
+// Process-wide limits on logging shared by all sites. See comments at the top
+// of the file.
+struct LogBudget {
+  // Zero means unlimited.
+  uint64_t bytes_per_second = 0;
+  // Zero means unlimited.
+  uint64_t records_per_second = 0;
+  // How often the summary of dropped records is logged.
+  Duration summary_period = std::chrono::seconds(60);
+};
+
+// Replaces the process-wide log budget. `SetLogBudget(LogBudget())` removes
+// it. Resets the sampling rates of all sites. Thread-safe.
+void SetLogBudget(const LogBudget& budget);
+
 namespace internal_logging {
 // Returns true if the log record passes the filter. `location_id` is from error
 // context.
@@ -281,22 +328,59 @@ struct Policy : Base {
   }
 };
 
+// True if there is a log budget.
+inline std::atomic<bool> budget_enabled{false};
+
+// Samples the record and charges it to the record budget. Returns false if the
+// record must be dropped.
+bool AdmitRecord(internal::LogSampling& site, const char* file, int line);
+
+// Charges `bytes` to the byte budget. Returns false if the record must be
+// dropped.
+bool AdmitBytes(internal::LogSampling& site, size_t bytes);
+
+// If the summary period has elapsed and some records have been dropped since
+// the last summary, writes the summary and returns true.
+bool TakeBudgetSummary(std::string* summary);
+
 extern template bool ShouldLog<NoFilter>(const NoFilter&, uintptr_t);
 extern template bool ShouldLog<FirstN>(const FirstN&, uintptr_t);
 extern template bool ShouldLog<EveryN>(const EveryN&, uintptr_t);
 extern template bool ShouldLog<EveryPow2>(const EveryPow2&, uintptr_t);
 extern template bool ShouldLog<Every>(const Every&, uintptr_t);
 
+// Non-owning reference to a function that prints the culprit. Null if
+// default-constructed.
+class CulpritPrinter {
+ public:
+  CulpritPrinter() = default;
+
+  template <class F>
+  explicit CulpritPrinter(const F& f)
+      : f_(&f), print_([](const void* f, std::ostream* strm) {
+          (*static_cast<const F*>(f))(strm);
+        }) {}
+
+  explicit operator bool() const { return print_ != nullptr; }
+  void operator()(std::ostream* strm) const { print_(f_, strm); }
+
+ private:
+  const void* f_ = nullptr;
+  void (*print_)(const void*, std::ostream*) = nullptr;
+};
+
 // In order to avoid code bloat, all formatting is within this non-inline
-// function.
+// function. The message is written to `strm`, which must be empty.
 //
-// `macro`, `macro_str`, `args_str` and `rel_expr` are from error context.
+// `macro`, `macro_str`, `args_str`, `rel_expr` and `index` are from error
+// context.
 // `print_culprit` can be null.
-std::string FormatMessage(
-    Macro macro, const char* macro_str, const char* args_str,
-    RelationalExpression* rel_expr,
-    const std::function<void(std::ostream*)>& print_culprit,
-    std::string_view policy_description, std::string_view builder_description);
+void FormatMessage(Macro macro, const char* macro_str, const char* args_str,
+                   RelationalExpression* rel_expr, std::ptrdiff_t index,
+                   CulpritPrinter print_culprit,
+                   std::string_view policy_description,
+                   std::string_view builder_description,
+                   internal::IndentingStream& strm);
 
 template <class Base>
 struct Builder : Observer<Base> {
@@ -347,34 +431,50 @@ struct Builder : Observer<Base> {
     } cleanup{this, ret_val};
     static_cast<void>(cleanup);
     const auto& ctx = this->context();
-    auto create_message = [&]() {
+    // Returns true if the error has been logged.
+    auto log = [&](const auto& logger) {
+      internal::LogSampling* site = nullptr;
+      if (budget_enabled.load(std::memory_order_relaxed)) {
+        site = &internal::GetSiteState(ctx.location_id).log_sampling;
+        std::string summary;
+        if (TakeBudgetSummary(&summary)) {
+          logger.Log(__FILE__, __LINE__, summary);
+        }
+        if (!AdmitRecord(*site, ctx.file, ctx.line)) return false;
+      }
       // Formatting and logging is ~100 times slower than filtering.
-      std::function<void(std::ostream*)> print_culprit;
+      auto print = [&](std::ostream* strm) {
+        merror::TryPrint(this->derived(), ctx.culprit, strm);
+      };
+      CulpritPrinter print_culprit;
       using Culprit = typename Builder::ContextType::Culprit;
       // Print only printable non-boring culprits.
       if (CanPrint<Builder, Culprit>() &&
           !std::is_empty<typename std::decay<Culprit>::type>()) {
-        print_culprit = [&](std::ostream* strm) {
-          merror::TryPrint(this->derived(), ctx.culprit, strm);
-        };
+        print_culprit = CulpritPrinter(print);
       }
-      return FormatMessage(ctx.macro, ctx.macro_str, ctx.args_str, ctx.rel_expr,
-                           print_culprit, merror::GetPolicyDescription(*this),
-                           merror::GetBuilderDescription(*this));
+      internal::ScratchStream msg;
+      FormatMessage(ctx.macro, ctx.macro_str, ctx.args_str, ctx.rel_expr,
+                    ctx.index, print_culprit,
+                    merror::GetPolicyDescription(*this),
+                    merror::GetBuilderDescription(*this), *msg);
+      if (site && !AdmitBytes(*site, msg->str().size())) return false;
+      logger.Log(ctx.file, ctx.line, msg->str());
+      return true;
     };
     auto logger = GetAnnotationOr<LogAndFilterAnnotation>(
         *this, LogAndFilter<NullLogger, NoFilter>());
     if (!logger.log.IsEnabled(ctx.file, ctx.line)) return;
     // `ShouldLog()` takes ~20ns when returning false.
-    if (logger.HasFilter()) {
-      if (!ShouldLog(logger.filter, ctx.location_id)) return;
-    } else {
-      if (!ShouldLog(
-              GetAnnotationOr<DefaultFilterAnnotation>(*this, NoFilter()),
-              ctx.location_id))
-        return;
-    }
-    logger.log.Log(ctx.file, ctx.line, create_message());
+    bool logged =
+        (logger.HasFilter()
+             ? ShouldLog(logger.filter, ctx.location_id)
+             : ShouldLog(
+                   GetAnnotationOr<DefaultFilterAnnotation>(*this, NoFilter()),
+                   ctx.location_id)) &&
+        log(logger.log);
+    internal_error_stats::CountLog(ctx.location_id, ctx.file, ctx.line,
+                                   logged);
   }
 };
 
@@ -0,0 +1,80 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Measures how log filters scale when a single site fails on many cores at
+// once. BM_SharedAtomic is the baseline: a single counter that all threads
+// increment. On a multi-socket machine run it with the threads spread across
+// sockets to see the cost of cross-socket cache line transfers:
+//
+//   $ numactl --interleave=all ./logging_benchmark --benchmark_filter=.
+//
+// The time per iteration should stay flat as threads are added for everything
+// except BM_SharedAtomic. Set MERROR_PERF_COUNTERS=1 to see cache misses.
+
+#include <atomic>
+#include <cstdint>
+
+#include "absl/status/status.h"
+#include "benchmark/benchmark.h"
+#include "merror/domain/internal/sharded_counter.h"
+#include "merror/internal/perf_counters.h"
+#include "merror/merror.h"
+
+namespace merror {
+namespace {
+
+constexpr auto MErrorDomain =
+    merror::Default().DefaultErrorCode(absl::StatusCode::kUnknown);
+
+constexpr int kMaxThreads = 64;
+
+void BM_SharedAtomic(benchmark::State& state) {
+  static std::atomic<int64_t> counter{0};
+  internal::PerfCounters perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(counter.fetch_add(1, std::memory_order_relaxed));
+  }
+  perf.Report(state);
+}
+BENCHMARK(BM_SharedAtomic)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+void BM_ShardedCounter(benchmark::State& state) {
+  static internal::ShardedCounter counter;
+  internal::PerfCounters perf;
+  for (auto _ : state) benchmark::DoNotOptimize(counter.Add());
+  perf.Report(state);
+}
+BENCHMARK(BM_ShardedCounter)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+// The filters are configured so that nothing passes and nothing is printed.
+absl::Status FirstNRejected() { return MERROR().CoutLog(FirstN(0)); }
+
+absl::Status EveryNRejected() { return MERROR().CoutLog(EveryN(0)); }
+
+void BM_FirstN(benchmark::State& state) {
+  internal::PerfCounters perf;
+  for (auto _ : state) benchmark::DoNotOptimize(FirstNRejected());
+  perf.Report(state);
+}
+BENCHMARK(BM_FirstN)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+void BM_EveryN(benchmark::State& state) {
+  internal::PerfCounters perf;
+  for (auto _ : state) benchmark::DoNotOptimize(EveryNRejected());
+  perf.Report(state);
+}
+BENCHMARK(BM_EveryN)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+}  // namespace
+}  // namespace merror
@@ -15,6 +15,7 @@
 
 #include "merror/domain/logging.h"
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <functional>
@@ -596,6 +597,25 @@ TEST(Logging, BecomeAlwaysTrue) {
   EXPECT_THAT(v, ElementsAre(EndsWith("1"), EndsWith("3")));
 }
 
+TEST(Logging, FirstNConcurrent) {
+  // Stands in for the location ID of a site; the filter only uses it as a key.
+  static const char site = 0;
+  std::atomic<int> accepted{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i != 8; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j != 10000; ++j) {
+        if (internal_logging::ShouldLog(
+                FirstN(100), reinterpret_cast<uintptr_t>(&site))) {
+          ++accepted;
+        }
+      }
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  EXPECT_EQ(100, accepted.load());
+}
+
 TEST(Logging, MultipleLocations) {
   std::string out;
   {
@@ -612,5 +632,96 @@ TEST(Logging, MultipleLocations) {
                              EndsWith("B3")));
 }
 
+TEST(Logging, RecordBudget) {
+  LogBudget budget;
+  budget.records_per_second = 5;
+  SetLogBudget(budget);
+  std::string out;
+  {
+    internal::CaptureStream c(std::cout);
+    for (int i = 0; i != 100; ++i) MERROR().CoutLog() << i;
+    out = c.str();
+  }
+  SetLogBudget(LogBudget());
+  // The bucket holds one second worth of records.
+  EXPECT_GE(Split(out).size(), 5);
+  EXPECT_LE(Split(out).size(), 6);
+}
+
+TEST(Logging, ByteBudget) {
+  LogBudget budget;
+  budget.bytes_per_second = 200;
+  SetLogBudget(budget);
+  std::string out;
+  {
+    internal::CaptureStream c(std::cout);
+    for (int i = 0; i != 100; ++i) {
+      MERROR().CoutLog() << std::string(49, 'x') << i % 10;
+    }
+    out = c.str();
+  }
+  SetLogBudget(LogBudget());
+  EXPECT_GE(Split(out).size(), 4);
+  EXPECT_LE(Split(out).size(), 5);
+}
+
+TEST(Logging, OversizedRecord) {
+  LogBudget budget;
+  budget.bytes_per_second = 100;
+  SetLogBudget(budget);
+  std::string out;
+  {
+    internal::CaptureStream c(std::cout);
+    for (int i = 0; i != 2; ++i) {
+      MERROR().CoutLog() << "record " << i << std::string(500, 'x');
+    }
+    out = c.str();
+  }
+  SetLogBudget(LogBudget());
+  // A record larger than the bucket is admitted when the bucket is full and
+  // drains it.
+  EXPECT_THAT(out, testing::HasSubstr("record 0"));
+  EXPECT_THAT(out, testing::Not(testing::HasSubstr("record 1")));
+}
+
+TEST(Logging, BudgetSummary) {
+  LogBudget budget;
+  budget.records_per_second = 1;
+  budget.summary_period = Duration::zero();
+  SetLogBudget(budget);
+  std::string out;
+  {
+    internal::CaptureStream c(std::cout);
+    for (int i = 0; i != 4; ++i) MERROR().CoutLog() << "record " << i;
+    out = c.str();
+  }
+  SetLogBudget(LogBudget());
+  // The first rejection halves the sampling rate of the site. The rest come
+  // within the same second and don't change it.
+  EXPECT_THAT(out, testing::HasSubstr("record 0"));
+  EXPECT_THAT(out, testing::Not(testing::HasSubstr("record 1")));
+  EXPECT_THAT(out, testing::ContainsRegex(
+                       "Log budget exceeded: dropped 1 records from 1 sites\n"
+                       "  .*logging_test.cc:[0-9]+: 1 dropped, logging 1 in 2"));
+  EXPECT_THAT(out, testing::Not(testing::HasSubstr("logging 1 in 4")));
+}
+
+TEST(Logging, BudgetRecovery) {
+  LogBudget budget;
+  budget.records_per_second = 2;
+  SetLogBudget(budget);
+  auto Burst = [](int n) {
+    internal::CaptureStream c(std::cout);
+    for (int i = 0; i != n; ++i) MERROR().CoutLog() << "record " << i;
+    return Split(c.str()).size();
+  };
+  // Drains the bucket and halves the sampling rate of the site.
+  EXPECT_EQ(2, Burst(3));
+  // A second later the bucket is full and the site logs every record again.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  EXPECT_EQ(2, Burst(2));
+  SetLogBudget(LogBudget());
+}
+
 }  // namespace
 }  // namespace merror
@@ -0,0 +1,153 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/no_alloc.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+
+namespace merror {
+
+void InlineDescription::Append(std::string_view s) {
+  if (truncated_) return;
+  if (s.size() <= kCapacity - size_) {
+    memcpy(data_ + size_, s.data(), s.size());
+    size_ += s.size();
+    return;
+  }
+  // Keep as much as fits while leaving room for the ellipsis.
+  static constexpr std::string_view kEllipsis = "...";
+  size_t keep = kCapacity - kEllipsis.size();
+  if (size_ < keep) {
+    memcpy(data_ + size_, s.data(), keep - size_);
+  }
+  memcpy(data_ + keep, kEllipsis.data(), kEllipsis.size());
+  size_ = kCapacity;
+  truncated_ = true;
+}
+
+void InlineDescription::AppendInt(int64_t n) {
+  char buf[24];
+  auto res = std::to_chars(buf, buf + sizeof(buf), n);
+  Append(std::string_view(buf, res.ptr - buf));
+}
+
+void InlineDescription::AppendUint(uint64_t n) {
+  char buf[24];
+  auto res = std::to_chars(buf, buf + sizeof(buf), n);
+  Append(std::string_view(buf, res.ptr - buf));
+}
+
+void InlineDescription::AppendDouble(double d) {
+  char buf[32];
+  auto res = std::to_chars(buf, buf + sizeof(buf), d);
+  Append(std::string_view(buf, res.ptr - buf));
+}
+
+// A record guarded by a seqlock. The fields are atomic because readers load
+// them while a writer may be storing them; the seqlock tells readers whether
+// what they've loaded is consistent.
+struct ErrorRing::Slot {
+  static constexpr size_t kDescriptionWords =
+      InlineDescription::kCapacity / sizeof(uint64_t);
+
+  // Odd while the record is being written.
+  std::atomic<uint64_t> seq{0};
+  std::atomic<uint64_t> sequence{0};
+  std::atomic<uintptr_t> location_id{0};
+  std::atomic<const char*> file{nullptr};
+  std::atomic<int> line{0};
+  std::atomic<const char*> macro_str{nullptr};
+  std::atomic<const char*> args_str{nullptr};
+  std::atomic<size_t> description_size{0};
+  std::atomic<uint64_t> description[kDescriptionWords] = {};
+};
+
+static_assert(InlineDescription::kCapacity % sizeof(uint64_t) == 0, "");
+
+ErrorRing::ErrorRing(size_t capacity)
+    : capacity_(capacity), slots_(new Slot[capacity]) {
+  assert(capacity > 0);
+}
+
+ErrorRing::~ErrorRing() = default;
+
+void ErrorRing::Add(uintptr_t location_id, const char* file, int line,
+                    const char* macro_str, const char* args_str,
+                    std::string_view description) {
+  uint64_t sequence = next_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[sequence % capacity_];
+  uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+  if ((seq & 1) != 0 ||
+      !slot.seq.compare_exchange_strong(seq, seq + 1,
+                                        std::memory_order_relaxed)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // Readers must not see the new fields without the odd sequence number.
+  std::atomic_thread_fence(std::memory_order_release);
+  uint64_t words[Slot::kDescriptionWords] = {};
+  size_t size = std::min(description.size(), sizeof(words));
+  if (size != 0) memcpy(words, description.data(), size);
+  for (size_t i = 0; i != Slot::kDescriptionWords; ++i) {
+    slot.description[i].store(words[i], std::memory_order_relaxed);
+  }
+  slot.description_size.store(size, std::memory_order_relaxed);
+  slot.sequence.store(sequence, std::memory_order_relaxed);
+  slot.location_id.store(location_id, std::memory_order_relaxed);
+  slot.file.store(file, std::memory_order_relaxed);
+  slot.line.store(line, std::memory_order_relaxed);
+  slot.macro_str.store(macro_str, std::memory_order_relaxed);
+  slot.args_str.store(args_str, std::memory_order_relaxed);
+  slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+std::vector<ErrorRecord> ErrorRing::Snapshot() const {
+  std::vector<ErrorRecord> res;
+  res.reserve(capacity_);
+  for (size_t i = 0; i != capacity_; ++i) {
+    const Slot& slot = slots_[i];
+    uint64_t before = slot.seq.load(std::memory_order_acquire);
+    if (before == 0 || (before & 1) != 0) continue;
+    ErrorRecord r;
+    r.sequence = slot.sequence.load(std::memory_order_relaxed);
+    r.location_id = slot.location_id.load(std::memory_order_relaxed);
+    r.file = slot.file.load(std::memory_order_relaxed);
+    r.line = slot.line.load(std::memory_order_relaxed);
+    r.macro_str = slot.macro_str.load(std::memory_order_relaxed);
+    r.args_str = slot.args_str.load(std::memory_order_relaxed);
+    r.description_size = std::min(
+        slot.description_size.load(std::memory_order_relaxed),
+        sizeof(r.description_data));
+    uint64_t words[Slot::kDescriptionWords];
+    for (size_t j = 0; j != Slot::kDescriptionWords; ++j) {
+      words[j] = slot.description[j].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != before) continue;
+    memcpy(r.description_data, words, sizeof(r.description_data));
+    res.push_back(r);
+  }
+  std::sort(res.begin(), res.end(),
+            [](const ErrorRecord& a, const ErrorRecord& b) {
+              return a.sequence < b.sequence;
+            });
+  return res;
+}
+
+}  // namespace merror
@@ -0,0 +1,296 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `NoAlloc`, an error domain for code that must not allocate, such as
+// audio or packet processing threads. It's composed only of extensions whose
+// failure path doesn't touch the heap:
+//
+//   * `MVERIFY()` accepts `bool`, pointers, `std::optional` and `absl::Status`.
+//     `MTRY()` accepts pointers, `std::optional` and `absl::StatusOr`.
+//   * Macros can return `bool`, pointers, `std::optional` and
+//     `absl::StatusCode`. The error code is chosen the same way as for
+//     `absl::Status` in `merror::Default()`: `ErrorCode()` and
+//     `DefaultErrorCode()` are available.
+//   * `Tee()` and `Return()` work as usual.
+//   * Objects streamed into the builder are formatted into a fixed buffer of
+//     `InlineDescription::kCapacity` bytes inside the builder. Longer
+//     descriptions are truncated and end with "...". Only arithmetic types,
+//     enums (printed as integers) and strings can be streamed.
+//   * `LogTo(&ring)` records every error into an `ErrorRing`, a preallocated
+//     ring buffer that can be written to from many threads without locks.
+//     `NoLogTo()` turns it off.
+//
+//   merror::ErrorRing ring(/*capacity=*/1024);
+//
+//   absl::StatusCode ProcessPacket(const Packet& p) {
+//     const auto MErrorDomain = merror::NoAlloc().LogTo(&ring);
+//     MVERIFY(p.size() <= kMaxSize).ErrorCode(absl::StatusCode::kOutOfRange)
+//         << "Packet of " << p.size() << " bytes from port " << p.port();
+//     ...
+//   }
+//
+//   // On another thread.
+//   for (const merror::ErrorRecord& r : ring.Snapshot()) {
+//     std::cout << r.file << ":" << r.line << ": " << r.description() << "\n";
+//   }
+//
+// Allocating features are compile errors rather than surprises at run time:
+// returning `absl::Status`, streaming into the policy, logging with `Log()`,
+// and streaming a type other than the ones listed above. Extending the domain
+// with `DescriptionBuilder` or `DynamicContext` trips a static assertion.
+//
+// `MTRY()` stashes the error in a thread-local map (see
+// //merror/internal/tls_map.h), which allocates once per thread and error
+// type. Call the function on each thread once during startup to make that
+// happen before real-time processing begins.
+
+#ifndef MERROR_5EDA97_DOMAIN_NO_ALLOC_H_
+#define MERROR_5EDA97_DOMAIN_NO_ALLOC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "merror/domain/adl_hooks.h"
+#include "merror/domain/base.h"
+#include "merror/domain/bool.h"
+#include "merror/domain/defer.h"
+#include "merror/domain/description.h"
+#include "merror/domain/error_passthrough.h"
+#include "merror/domain/fill_error.h"
+#include "merror/domain/forward.h"
+#include "merror/domain/method_hooks.h"
+#include "merror/domain/observer.h"
+#include "merror/domain/optional.h"
+#include "merror/domain/pointer.h"
+#include "merror/domain/return.h"
+#include "merror/domain/status.h"
+#include "merror/domain/tee.h"
+#include "merror/domain/verify_via_try.h"
+
+namespace merror {
+
+// Fixed-capacity error description. `NoAlloc` builders store it under
+// `BuilderDescriptionAnnotation`.
+class InlineDescription {
+ public:
+  static constexpr size_t kCapacity = 128;
+
+  explicit operator std::string_view() const { return {data_, size_}; }
+
+  void Append(std::string_view s);
+  void Append(bool b) { Append(b ? std::string_view("true") : "false"); }
+  void Append(char c) { Append(std::string_view(&c, 1)); }
+  void AppendInt(int64_t n);
+  void AppendUint(uint64_t n);
+  void AppendDouble(double d);
+
+ private:
+  char data_[kCapacity] = {};
+  size_t size_ = 0;
+  bool truncated_ = false;
+};
+
+// An error recorded by `ErrorRing`.
+struct ErrorRecord {
+  // The position of the record among all records added to the ring.
+  uint64_t sequence;
+  // Same as the fields of `Context`.
+  uintptr_t location_id;
+  const char* file;
+  int line;
+  const char* macro_str;
+  const char* args_str;
+
+  std::string_view description() const {
+    return {description_data, description_size};
+  }
+
+  char description_data[InlineDescription::kCapacity];
+  size_t description_size;
+};
+
+// Preallocated ring buffer of the most recent errors. See comments at the top
+// of the file.
+class ErrorRing {
+ public:
+  // Allocates room for `capacity` records. Requires `capacity > 0`.
+  explicit ErrorRing(size_t capacity);
+  ~ErrorRing();
+
+  ErrorRing(const ErrorRing&) = delete;
+  ErrorRing& operator=(const ErrorRing&) = delete;
+
+  // Overwrites the oldest record. Lock-free and allocation-free. If another
+  // thread is still writing to the same slot, which requires `capacity` other
+  // records to be added in the meantime, the record is dropped.
+  void Add(uintptr_t location_id, const char* file, int line,
+           const char* macro_str, const char* args_str,
+           std::string_view description);
+
+  // Returns up to `capacity` most recent records, oldest first. Records that
+  // are being written concurrently are skipped. Allocates.
+  std::vector<ErrorRecord> Snapshot() const;
+
+  // The number of calls to `Add()`.
+  uint64_t total() const { return next_.load(std::memory_order_relaxed); }
+
+  // The number of records dropped by `Add()`.
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Slot;
+
+  const size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> next_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+namespace internal_no_alloc {
+
+struct ErrorRingAnnotation {};
+
+// True if objects of type `T` can be written to `InlineDescription`.
+template <class T>
+constexpr bool kInlineFormattable =
+    std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+    std::is_convertible<const T&, std::string_view>::value;
+
+template <class T>
+void WriteInline(InlineDescription& d, const T& val) {
+  if constexpr (std::is_same<T, bool>::value || std::is_same<T, char>::value) {
+    d.Append(val);
+  } else if constexpr (std::is_enum<T>::value) {
+    WriteInline(d, static_cast<std::underlying_type_t<T>>(val));
+  } else if constexpr (std::is_integral<T>::value &&
+                       std::is_signed<T>::value) {
+    d.AppendInt(val);
+  } else if constexpr (std::is_integral<T>::value) {
+    d.AppendUint(val);
+  } else if constexpr (std::is_floating_point<T>::value) {
+    d.AppendDouble(val);
+  } else {
+    d.Append(std::string_view(val));
+  }
+}
+
+template <class Base>
+struct Policy : Base {
+  constexpr auto LogTo(ErrorRing* ring) const {
+    return AddAnnotation<ErrorRingAnnotation>(*this, ring);
+  }
+
+  template <class X = void>
+  constexpr auto NoLogTo() const
+      -> decltype(RemoveAnnotations<ErrorRingAnnotation>(Defer<X>(*this))) {
+    return RemoveAnnotations<ErrorRingAnnotation>(*this);
+  }
+};
+
+template <class Base>
+struct Builder : Observer<Base> {
+  auto LogTo(ErrorRing* ring) && {
+    return AddAnnotation<ErrorRingAnnotation>(std::move(*this), ring);
+  }
+
+  // Overrides the ring of the policy, if any.
+  auto NoLogTo() && {
+    return AddAnnotation<ErrorRingAnnotation>(std::move(*this),
+                                              static_cast<ErrorRing*>(nullptr));
+  }
+
+  template <class RetVal>
+  void ObserveRetVal(const RetVal& ret_val) {
+    static_assert(!HasAnnotation<PolicyDescriptionAnnotation, Base>(),
+                  "NoAlloc() doesn't support policy descriptions; they are "
+                  "allocated on the heap");
+    if constexpr (HasAnnotation<BuilderDescriptionAnnotation, Base>()) {
+      static_assert(
+          std::is_same<std::decay_t<decltype(
+                           GetAnnotation<BuilderDescriptionAnnotation>(*this))>,
+                       InlineDescription>::value,
+          "NoAlloc() supports only inline builder descriptions");
+    }
+    ErrorRing* ring = GetAnnotationOr<ErrorRingAnnotation>(
+        *this, static_cast<ErrorRing*>(nullptr));
+    if (ring) {
+      const auto& ctx = this->context();
+      ring->Add(ctx.location_id, ctx.file, ctx.line, ctx.macro_str,
+                ctx.args_str, merror::GetBuilderDescription(*this));
+    }
+    Observer<Base>::ObserveRetVal(ret_val);
+  }
+};
+
+struct InlineAppend {
+  template <class T>
+  void operator()(InlineDescription& d, const T& val) const {
+    WriteInline(d, val);
+  }
+};
+
+template <class Base, class T>
+auto Write(Builder<Base>&& b, const T& val)
+    -> decltype(internal_description::WriteDescription<InlineDescription,
+                                                       InlineAppend>(
+        std::move(b), val)) {
+  return internal_description::WriteDescription<InlineDescription,
+                                                InlineAppend>(std::move(b),
+                                                              val);
+}
+
+template <class Base, class T>
+auto operator<<(Builder<Base>&& b, const T& val)
+    -> decltype(internal_no_alloc::Write(std::move(b), val)) {
+  static_assert(kInlineFormattable<T>,
+                "NoAlloc() builders accept only arithmetic types, enums and "
+                "strings");
+  return internal_no_alloc::Write(std::move(b), val);
+}
+
+template <class Base>
+using DomainPolicy = internal_status::AcceptStatus<
+    internal_pointer::AcceptPointer<internal_optional::AcceptOptional<
+        internal_bool::AcceptBool<internal_status::StatusBuilder::Policy<
+            Policy<internal_tee::Policy<internal_return::Policy<
+                internal_forward::Facade<internal_method_hooks::Policy<
+                    internal_adl_hooks::Policy<
+                        internal_verify_via_try::Policy<Base>>>>>>>>>>>>;
+
+template <class Base>
+using DomainBuilder = internal_status::MakeStatusCode<
+    internal_pointer::MakePointer<internal_optional::MakeOptional<
+        internal_bool::MakeBool<Builder<internal_status::StatusBuilder::Builder<
+            internal_tee::Builder<internal_return::Builder<
+                internal_method_hooks::Builder<internal_adl_hooks::Builder<
+                    internal_error_passthrough::Builder<
+                        internal_fill_error::Builder<Base>>>>>>>>>>>>;
+
+}  // namespace internal_no_alloc
+
+// Error domain that never allocates on the failure path. See comments at the
+// top of the file for details.
+using NoAlloc = Domain<internal_no_alloc::DomainPolicy,
+                       internal_no_alloc::DomainBuilder>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_NO_ALLOC_H_
@@ -0,0 +1,169 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/no_alloc.h"
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::testing::EndsWith;
+using ::testing::SizeIs;
+
+constexpr auto MErrorDomain = NoAlloc();
+
+enum class Color { kRed = 3 };
+
+TEST(NoAlloc, ReturnsStatusCode) {
+  auto F = [](int x) -> absl::StatusCode {
+    MVERIFY(x > 0).ErrorCode(absl::StatusCode::kInvalidArgument);
+    return absl::StatusCode::kOk;
+  };
+  EXPECT_EQ(absl::StatusCode::kOk, F(1));
+  EXPECT_EQ(absl::StatusCode::kInvalidArgument, F(0));
+
+  auto G = [](absl::StatusOr<int> x) -> absl::StatusCode {
+    MTRY(x);
+    return absl::StatusCode::kOk;
+  };
+  EXPECT_EQ(absl::StatusCode::kNotFound, G(absl::NotFoundError("")));
+}
+
+TEST(NoAlloc, ReturnsBoolPointerAndOptional) {
+  auto F = [](const int* p) -> bool {
+    MVERIFY(p);
+    return true;
+  };
+  EXPECT_FALSE(F(nullptr));
+  auto G = [](std::optional<int> x) -> const int* {
+    static const int kOne = 1;
+    MTRY(x);
+    return &kOne;
+  };
+  EXPECT_EQ(nullptr, G(std::nullopt));
+  auto H = [](bool x) -> std::optional<int> {
+    MVERIFY(x);
+    return 1;
+  };
+  EXPECT_EQ(std::nullopt, H(false));
+}
+
+TEST(NoAlloc, InlineDescription) {
+  ErrorRing ring(4);
+  auto F = [&](int x) -> bool {
+    MVERIFY(x > 0).LogTo(&ring)
+        << "x=" << x << " n=" << 7u << " r=" << 0.5 << " " << true << ' '
+        << Color::kRed << " " << std::string("s");
+    return true;
+  };
+  EXPECT_FALSE(F(-1));
+  std::vector<ErrorRecord> records = ring.Snapshot();
+  ASSERT_THAT(records, SizeIs(1));
+  EXPECT_EQ("x=-1 n=7 r=0.5 true 3 s", records[0].description());
+  EXPECT_STREQ("MVERIFY", records[0].macro_str);
+  EXPECT_STREQ("x > 0", records[0].args_str);
+}
+
+TEST(NoAlloc, TruncatesLongDescriptions) {
+  ErrorRing ring(1);
+  const auto MErrorDomain = NoAlloc().LogTo(&ring);
+  auto F = [&]() -> bool {
+    std::string s(100, 'a');
+    MVERIFY(false) << s << s;
+    return true;
+  };
+  F();
+  std::vector<ErrorRecord> records = ring.Snapshot();
+  ASSERT_THAT(records, SizeIs(1));
+  EXPECT_EQ(InlineDescription::kCapacity, records[0].description().size());
+  EXPECT_THAT(std::string(records[0].description()), EndsWith("aaa..."));
+}
+
+TEST(NoAlloc, NoLogTo) {
+  ErrorRing ring(1);
+  const auto MErrorDomain = NoAlloc().LogTo(&ring);
+  auto F = [&]() -> bool {
+    MVERIFY(false).NoLogTo();
+    return true;
+  };
+  F();
+  EXPECT_EQ(0, ring.total());
+}
+
+TEST(ErrorRing, KeepsMostRecent) {
+  ErrorRing ring(4);
+  for (int i = 0; i != 6; ++i) ring.Add(1, "f", i, "M", "", "");
+  std::vector<ErrorRecord> records = ring.Snapshot();
+  ASSERT_THAT(records, SizeIs(4));
+  for (int i = 0; i != 4; ++i) {
+    EXPECT_EQ(i + 2, records[i].sequence);
+    EXPECT_EQ(i + 2, records[i].line);
+  }
+  EXPECT_EQ(6, ring.total());
+}
+
+TEST(ErrorRing, Concurrent) {
+  ErrorRing ring(64);
+  std::vector<std::thread> threads;
+  for (int t = 0; t != 4; ++t) {
+    threads.emplace_back([&ring, t] {
+      std::string description(t + 1, 'x');
+      for (int i = 0; i != 10000; ++i) {
+        ring.Add(t, "f", t, "M", "", description);
+      }
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  EXPECT_EQ(40000, ring.total());
+  std::vector<ErrorRecord> records = ring.Snapshot();
+  EXPECT_LE(records.size(), 64);
+  for (const ErrorRecord& r : records) {
+    EXPECT_EQ(r.line, r.location_id);
+    EXPECT_EQ(r.line + 1, r.description().size());
+  }
+}
+
+TEST(ErrorRing, ConcurrentReaders) {
+  ErrorRing ring(8);
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int i = 0; i != 100000; ++i) {
+      int n = i % 100 + 1;
+      ring.Add(n, "f", n, "M", "", std::string(n, 'a' + n % 26));
+    }
+    done = true;
+  });
+  // Every record that is read must be one that has been written.
+  while (!done) {
+    for (const ErrorRecord& r : ring.Snapshot()) {
+      ASSERT_EQ(r.line, r.location_id);
+      ASSERT_EQ(std::string(r.line, 'a' + r.line % 26), r.description());
+    }
+  }
+  writer.join();
+}
+
+}  // namespace
+}  // namespace merror
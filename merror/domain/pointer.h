@@ -59,14 +59,25 @@ using EnableIf = typename std::enable_if<C, int>::type;
 //
 // The existence of element_type is necessary to exclude optional<U*> and other
 // value wrappers.
+//
+// The comparison with nullptr is checked only for types that pass the other
+// checks. Value wrappers such as std::expected have unconstrained comparison
+// operators that fail to compile when instantiated with nullptr.
+template <class T, class = void>
+struct IsSmartPtr : std::false_type {};
+
+template <class T>
+struct IsSmartPtr<
+    T, typename std::enable_if<
+           std::is_same<typename T::element_type*,
+                        decltype(std::declval<T&>().operator->())>::value &&
+           std::is_same<typename T::element_type&,
+                        decltype(*std::declval<T&>())>::value>::type>
+    : std::is_convertible<decltype(std::declval<const T&>() == nullptr),
+                          bool> {};
+
 template <class T>
-using SmartPtrEnabler =
-    EnableIf<std::is_same<typename T::element_type*,
-                          decltype(std::declval<T&>().operator->())>::value &&
-             std::is_same<typename T::element_type&,
-                          decltype(*std::declval<T&>())>::value &&
-             std::is_convertible<decltype(std::declval<const T&>() == nullptr),
-                                 bool>::value>;
+using SmartPtrEnabler = EnableIf<IsSmartPtr<T>::value>;
 
 struct VerifyAcceptor {
   template <class Ptr>
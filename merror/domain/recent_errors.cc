@@ -0,0 +1,260 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/recent_errors.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace merror {
+
+// A distinct error of a site. The fields are atomic because readers load them
+// while a writer may be storing them; the seqlock tells readers whether what
+// they've loaded is consistent.
+struct RecentErrorsTable::Entry {
+  static constexpr size_t kTextWords = kMaxMessageSize / sizeof(uint64_t);
+
+  // Odd while a writer is replacing the entry.
+  std::atomic<uint32_t> seq{0};
+  std::atomic<int32_t> code{-1};
+  std::atomic<uint64_t> hash{0};
+  std::atomic<uint64_t> count{0};
+  // Nanoseconds since the Unix epoch. `last_ns` is zero if the entry is empty.
+  std::atomic<int64_t> first_ns{0};
+  std::atomic<int64_t> last_ns{0};
+  std::atomic<uint32_t> size{0};
+  std::atomic<uint64_t> text[kTextWords] = {};
+};
+
+struct RecentErrorsTable::Site {
+  // Zero if the slot is free.
+  std::atomic<uintptr_t> location_id{0};
+  std::atomic<const char*> file{nullptr};
+  // Zero until `file` has been written.
+  std::atomic<int> line{0};
+};
+
+namespace {
+
+static_assert(RecentErrorsTable::kMaxMessageSize % sizeof(uint64_t) == 0, "");
+
+std::atomic<uint32_t> next_generation{1};
+
+uint64_t Hash(int code, std::string_view message) {
+  uint64_t h = std::hash<std::string_view>()(message);
+  return (h ^ static_cast<uint32_t>(code)) * 0x9E3779B97F4A7C15;
+}
+
+}  // namespace
+
+RecentErrorsTable::RecentErrorsTable(uint32_t num_sites,
+                                     uint32_t errors_per_site)
+    : num_sites_(num_sites),
+      errors_per_site_(errors_per_site),
+      generation_(next_generation.fetch_add(1, std::memory_order_relaxed)),
+      sites_(new Site[num_sites]),
+      entries_(new Entry[size_t{num_sites} * errors_per_site]) {}
+
+RecentErrorsTable::~RecentErrorsTable() = default;
+
+RecentErrorsTable::Site* RecentErrorsTable::GetSite(uintptr_t location_id,
+                                                    const char* file,
+                                                    int line) {
+  std::atomic<uint64_t>& cache =
+      internal::GetSiteState(location_id).recent_errors_slot;
+  uint64_t cached = cache.load(std::memory_order_relaxed);
+  if (cached >> 32 == generation_) {
+    uint32_t index = static_cast<uint32_t>(cached);
+    return index ? &sites_[index - 1] : nullptr;
+  }
+  uint32_t index = 0;
+  // Open addressing with linear probing. Slots are never freed.
+  uint64_t h = location_id * 0x9E3779B97F4A7C15;
+  for (uint32_t i = 0; i != num_sites_; ++i) {
+    uint32_t n = static_cast<uint32_t>((h + i) % num_sites_);
+    Site& site = sites_[n];
+    uintptr_t id = site.location_id.load(std::memory_order_relaxed);
+    if (id == 0 && site.location_id.compare_exchange_strong(
+                       id, location_id, std::memory_order_relaxed)) {
+      site.file.store(file, std::memory_order_relaxed);
+      site.line.store(line, std::memory_order_release);
+      index = n + 1;
+      break;
+    }
+    if (id == location_id) {
+      index = n + 1;
+      break;
+    }
+  }
+  if (index == 0) overflow_.fetch_add(1, std::memory_order_relaxed);
+  cache.store(uint64_t{generation_} << 32 | index, std::memory_order_relaxed);
+  return index ? &sites_[index - 1] : nullptr;
+}
+
+void RecentErrorsTable::Record(uintptr_t location_id, const char* file,
+                               int line, int code, std::string_view message) {
+  if (errors_per_site_ == 0) return;
+  Site* site = GetSite(location_id, file, line);
+  if (!site) return;
+  Entry* entries = &entries_[(site - sites_.get()) * size_t{errors_per_site_}];
+  const uint64_t hash = Hash(code, message);
+  const int64_t now = absl::GetCurrentTimeNanos();
+  // Bump the entry of the same error or replace the least recently seen one.
+  Entry* victim = &entries[0];
+  int64_t victim_last = INT64_MAX;
+  for (uint32_t i = 0; i != errors_per_site_; ++i) {
+    Entry& e = entries[i];
+    int64_t last = e.last_ns.load(std::memory_order_relaxed);
+    if (last != 0 && e.hash.load(std::memory_order_relaxed) == hash &&
+        e.code.load(std::memory_order_relaxed) == code) {
+      e.count.fetch_add(1, std::memory_order_relaxed);
+      e.last_ns.store(now, std::memory_order_relaxed);
+      return;
+    }
+    if (last < victim_last) {
+      victim = &e;
+      victim_last = last;
+    }
+  }
+  uint32_t seq = victim->seq.load(std::memory_order_relaxed);
+  if ((seq & 1) || !victim->seq.compare_exchange_strong(
+                       seq, seq + 1, std::memory_order_relaxed)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // Readers must not see the new fields without the odd sequence number.
+  std::atomic_thread_fence(std::memory_order_release);
+  uint64_t text[Entry::kTextWords] = {};
+  size_t size = std::min(message.size(), kMaxMessageSize);
+  if (size != 0) memcpy(text, message.data(), size);
+  for (size_t i = 0; i != Entry::kTextWords; ++i) {
+    victim->text[i].store(text[i], std::memory_order_relaxed);
+  }
+  victim->size.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+  victim->code.store(code, std::memory_order_relaxed);
+  victim->hash.store(hash, std::memory_order_relaxed);
+  victim->count.store(1, std::memory_order_relaxed);
+  victim->first_ns.store(now, std::memory_order_relaxed);
+  victim->last_ns.store(now, std::memory_order_relaxed);
+  victim->seq.store(seq + 2, std::memory_order_release);
+}
+
+namespace {
+
+// Copies the entry if it isn't empty. Gives up if writers keep replacing it.
+template <class Entry>
+bool Read(const Entry& e, RecentError& err) {
+  for (int attempt = 0; attempt != 64; ++attempt) {
+    uint32_t seq = e.seq.load(std::memory_order_acquire);
+    if (seq & 1) continue;
+    int64_t last = e.last_ns.load(std::memory_order_relaxed);
+    int64_t first = e.first_ns.load(std::memory_order_relaxed);
+    uint64_t count = e.count.load(std::memory_order_relaxed);
+    int code = e.code.load(std::memory_order_relaxed);
+    uint32_t size = e.size.load(std::memory_order_relaxed);
+    uint64_t text[Entry::kTextWords];
+    for (size_t i = 0; i != Entry::kTextWords; ++i) {
+      text[i] = e.text[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (e.seq.load(std::memory_order_relaxed) != seq) continue;
+    if (last == 0) return false;
+    err.code = code;
+    err.message.assign(reinterpret_cast<const char*>(text),
+                       std::min<size_t>(size, sizeof(text)));
+    err.count = count;
+    err.first_seen = absl::FromUnixNanos(first);
+    err.last_seen = absl::FromUnixNanos(std::max(first, last));
+    return true;
+  }
+  return false;
+}
+
+std::string FormatTimestamp(absl::Time t) {
+  return absl::FormatTime("%Y-%m-%dT%H:%M:%E3SZ", t, absl::UTCTimeZone());
+}
+
+}  // namespace
+
+std::vector<SiteRecentErrors> RecentErrorsTable::Snapshot() const {
+  std::vector<SiteRecentErrors> res;
+  for (uint32_t i = 0; i != num_sites_; ++i) {
+    const Site& site = sites_[i];
+    int line = site.line.load(std::memory_order_acquire);
+    if (line == 0) continue;
+    SiteRecentErrors s{site.file.load(std::memory_order_relaxed), line, {}};
+    const Entry* entries = &entries_[i * size_t{errors_per_site_}];
+    for (uint32_t j = 0; j != errors_per_site_; ++j) {
+      RecentError err;
+      if (Read(entries[j], err)) s.errors.push_back(std::move(err));
+    }
+    if (s.errors.empty()) continue;
+    std::sort(s.errors.begin(), s.errors.end(),
+              [](const RecentError& a, const RecentError& b) {
+                return a.last_seen > b.last_seen;
+              });
+    res.push_back(std::move(s));
+  }
+  // Sites with the most recent errors come first.
+  std::sort(res.begin(), res.end(),
+            [](const SiteRecentErrors& a, const SiteRecentErrors& b) {
+              return a.errors[0].last_seen > b.errors[0].last_seen;
+            });
+  return res;
+}
+
+std::string RecentErrorsTable::Render() const {
+  std::ostringstream strm;
+  for (const SiteRecentErrors& site : Snapshot()) {
+    strm << site.file << ":" << site.line << "\n";
+    for (const RecentError& err : site.errors) {
+      strm << "  x" << err.count << ", last " << FormatTimestamp(err.last_seen)
+           << ", first " << FormatTimestamp(err.first_seen) << "\n    ";
+      if (err.code >= 0) {
+        auto code = static_cast<absl::StatusCode>(err.code);
+        strm << absl::StatusCodeToString(code) << ": ";
+      }
+      // Messages may span several lines.
+      for (char c : err.message) {
+        strm << c;
+        if (c == '\n') strm << "    ";
+      }
+      strm << "\n";
+    }
+  }
+  if (overflow() != 0 || dropped() != 0) {
+    strm << overflow() << " sites not recorded, " << dropped()
+         << " errors dropped\n";
+  }
+  return strm.str();
+}
+
+void SetRecentErrorsTable(RecentErrorsTable* table) {
+  internal_recent_errors::table.store(table, std::memory_order_release);
+}
+
+}  // namespace merror
@@ -0,0 +1,195 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `RecentErrorsTable` and `RecentErrors`. A `RecentErrorsTable` keeps
+// the last few distinct errors of each site, with their status codes, counts
+// and timestamps, so that a debug page can show them without logging being
+// enabled. The `RecentErrors` error domain extension records errors in it.
+//
+//   int main() {
+//     static auto* table = new merror::RecentErrorsTable(
+//         /*num_sites=*/1024, /*errors_per_site=*/4);
+//     merror::SetRecentErrorsTable(table);
+//     ...
+//   }
+//
+//   constexpr auto MErrorDomain =
+//       merror::Default().With(merror::RecentErrors());
+//
+//   void HandleStatusz(Response& resp) {
+//     resp.Write(table->Render());
+//   }
+//
+// Two errors are the same if they have the same status code and message. The
+// code and the message come from the error being returned if it's a status,
+// or else from the culprit. Messages are stored truncated to 128 bytes. When a
+// site sees an error it doesn't have yet, the error replaces the one that was
+// seen least recently.
+//
+// Sites claim slots on their first error, like in `ErrorStatsTable` (see
+// //merror/domain/error_stats.h). All memory is allocated by the constructor.
+// Writers never block: each entry is guarded by a seqlock, a writer that finds
+// the entry taken by another writer drops its error and counts it in
+// `dropped()`, and readers retry until they see a consistent entry. Counts and
+// timestamps of an entry that is being replaced may be off by one error.
+//
+// The table must outlive all errors that may be recorded in it. In practice it
+// should be created at startup and never destroyed.
+
+#ifndef MERROR_5EDA97_DOMAIN_RECENT_ERRORS_H_
+#define MERROR_5EDA97_DOMAIN_RECENT_ERRORS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "merror/domain/base.h"
+#include "merror/domain/observer.h"
+#include "merror/types.h"
+
+namespace merror {
+
+// An error as seen by `RecentErrorsTable::Snapshot()`.
+struct RecentError {
+  // -1 if the error had no status code.
+  int code;
+  // Truncated to `RecentErrorsTable::kMaxMessageSize` bytes.
+  std::string message;
+  uint64_t count;
+  absl::Time first_seen;
+  absl::Time last_seen;
+};
+
+// The errors of a single site, most recent first.
+struct SiteRecentErrors {
+  const char* file;
+  int line;
+  std::vector<RecentError> errors;
+};
+
+// See comments at the top of the file.
+class RecentErrorsTable {
+ public:
+  static constexpr size_t kMaxMessageSize = 128;
+
+  // Preallocates room for `errors_per_site` distinct errors at each of
+  // `num_sites` sites.
+  RecentErrorsTable(uint32_t num_sites, uint32_t errors_per_site);
+  ~RecentErrorsTable();
+
+  RecentErrorsTable(const RecentErrorsTable&) = delete;
+  RecentErrorsTable& operator=(const RecentErrorsTable&) = delete;
+
+  // Records an error of the site. `file` must have infinite lifetime. `code` is
+  // -1 if the error has no status code.
+  void Record(uintptr_t location_id, const char* file, int line, int code,
+              std::string_view message);
+
+  // Returns the errors of all sites that have claimed a slot.
+  std::vector<SiteRecentErrors> Snapshot() const;
+
+  // Formats a snapshot as text, most recent first:
+  //
+  //   foo.cc:42
+  //     x3, last 2021-06-01T12:00:03.141Z, first 2021-06-01T11:58:09.265Z
+  //       NOT_FOUND: No such user
+  std::string Render() const;
+
+  // The number of sites that didn't get a slot because the table was full.
+  uint64_t overflow() const {
+    return overflow_.load(std::memory_order_relaxed);
+  }
+
+  // The number of errors that weren't recorded because another thread was
+  // writing the same entry.
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Entry;
+  struct Site;
+
+  Site* GetSite(uintptr_t location_id, const char* file, int line);
+
+  const uint32_t num_sites_;
+  const uint32_t errors_per_site_;
+  // Unique among the tables of the process. Never zero.
+  const uint32_t generation_;
+  std::unique_ptr<Site[]> sites_;
+  std::unique_ptr<Entry[]> entries_;
+  std::atomic<uint64_t> overflow_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+// Sets the table in which errors are recorded. Null disables recording.
+void SetRecentErrorsTable(RecentErrorsTable* table);
+
+namespace internal_recent_errors {
+
+inline std::atomic<RecentErrorsTable*> table{nullptr};
+
+// The status code and the message of an error, if it has them.
+struct Summary {
+  int code = -1;
+  std::string_view message;
+};
+
+inline Summary Summarize(const absl::Status& status) {
+  return {static_cast<int>(status.code()), status.message()};
+}
+
+inline Summary Summarize(absl::StatusCode code) {
+  return {static_cast<int>(code), {}};
+}
+
+template <class T>
+Summary Summarize(const absl::StatusOr<T>& status_or) {
+  return Summarize(status_or.status());
+}
+
+template <class T>
+Summary Summarize(const T&) {
+  return {};
+}
+
+template <class Base>
+struct Builder : Observer<Base> {
+  template <class RetVal>
+  void ObserveRetVal(const RetVal& ret_val) {
+    if (RecentErrorsTable* t = table.load(std::memory_order_acquire)) {
+      const auto& ctx = this->context();
+      Summary s = Summarize(ret_val);
+      if (s.code < 0) s = Summarize(ctx.culprit);
+      t->Record(ctx.location_id, ctx.file, ctx.line, s.code, s.message);
+    }
+    Observer<Base>::ObserveRetVal(ret_val);
+  }
+};
+
+}  // namespace internal_recent_errors
+
+// Error domain extension that records errors in the table passed to
+// `SetRecentErrorsTable()`. See comments at the top of the file for details.
+using RecentErrors = Builder<internal_recent_errors::Builder>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_RECENT_ERRORS_H_
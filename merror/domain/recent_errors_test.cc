@@ -0,0 +1,165 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/recent_errors.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::absl::StatusCode;
+using ::testing::EndsWith;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+constexpr auto MErrorDomain = Default().With(RecentErrors());
+
+class RecentErrorsTest : public ::testing::Test {
+ protected:
+  ~RecentErrorsTest() override { SetRecentErrorsTable(nullptr); }
+};
+
+absl::Status Check(absl::Status s) {
+  MVERIFY(s);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<int> Lookup(absl::StatusOr<int> x) { return MTRY(x) + 1; }
+
+TEST_F(RecentErrorsTest, Disabled) {
+  RecentErrorsTable table(4, 2);
+  EXPECT_EQ(StatusCode::kNotFound, Check(absl::NotFoundError("a")).code());
+  EXPECT_THAT(table.Snapshot(), IsEmpty());
+  EXPECT_EQ("", table.Render());
+}
+
+TEST_F(RecentErrorsTest, DistinctErrors) {
+  RecentErrorsTable table(4, 2);
+  SetRecentErrorsTable(&table);
+  EXPECT_TRUE(Check(absl::OkStatus()).ok());
+  Check(absl::NotFoundError("a")).IgnoreError();
+  Check(absl::NotFoundError("a")).IgnoreError();
+  Check(absl::NotFoundError("b")).IgnoreError();
+  Check(absl::InternalError("a")).IgnoreError();
+
+  std::vector<SiteRecentErrors> snapshot = table.Snapshot();
+  ASSERT_EQ(1, snapshot.size());
+  EXPECT_THAT(snapshot[0].file, EndsWith("recent_errors_test.cc"));
+  EXPECT_NE(0, snapshot[0].line);
+  // "NOT_FOUND: a" was seen least recently and has been replaced.
+  std::vector<std::pair<int, std::string>> errors;
+  for (const RecentError& err : snapshot[0].errors) {
+    EXPECT_EQ(1, err.count);
+    errors.emplace_back(err.code, err.message);
+  }
+  EXPECT_THAT(errors, UnorderedElementsAre(
+                          Pair(static_cast<int>(StatusCode::kInternal), "a"),
+                          Pair(static_cast<int>(StatusCode::kNotFound), "b")));
+  EXPECT_GE(snapshot[0].errors[0].last_seen, snapshot[0].errors[1].last_seen);
+  EXPECT_EQ(0, table.dropped());
+}
+
+TEST_F(RecentErrorsTest, Counts) {
+  RecentErrorsTable table(4, 2);
+  SetRecentErrorsTable(&table);
+  for (int i = 0; i != 3; ++i) {
+    Lookup(absl::UnavailableError("down")).IgnoreError();
+  }
+  EXPECT_EQ(3, *Lookup(2));
+  std::vector<SiteRecentErrors> snapshot = table.Snapshot();
+  ASSERT_EQ(1, snapshot.size());
+  ASSERT_EQ(1, snapshot[0].errors.size());
+  const RecentError& err = snapshot[0].errors[0];
+  EXPECT_EQ(3, err.count);
+  EXPECT_LE(err.first_seen, err.last_seen);
+  std::string text = table.Render();
+  EXPECT_THAT(text, HasSubstr("recent_errors_test.cc:"));
+  EXPECT_THAT(text, HasSubstr("\n  x3, last "));
+  EXPECT_THAT(text, HasSubstr("\n    UNAVAILABLE: down\n"));
+}
+
+TEST_F(RecentErrorsTest, Truncation) {
+  RecentErrorsTable table(1, 1);
+  SetRecentErrorsTable(&table);
+  Check(absl::AbortedError(std::string(1000, 'x'))).IgnoreError();
+  std::vector<SiteRecentErrors> snapshot = table.Snapshot();
+  ASSERT_EQ(1, snapshot.size());
+  EXPECT_EQ(RecentErrorsTable::kMaxMessageSize,
+            snapshot[0].errors[0].message.size());
+}
+
+TEST_F(RecentErrorsTest, Overflow) {
+  RecentErrorsTable table(1, 1);
+  SetRecentErrorsTable(&table);
+  Check(absl::AbortedError("")).IgnoreError();
+  Lookup(absl::AbortedError("")).IgnoreError();
+  EXPECT_EQ(1, table.Snapshot().size());
+  EXPECT_EQ(1, table.overflow());
+  EXPECT_THAT(table.Render(), HasSubstr("1 sites not recorded"));
+}
+
+TEST_F(RecentErrorsTest, NoCode) {
+  RecentErrorsTable table(1, 1);
+  SetRecentErrorsTable(&table);
+  auto F = [](bool ok) {
+    MVERIFY(ok).Return<bool>();
+    return true;
+  };
+  EXPECT_FALSE(F(false));
+  std::vector<SiteRecentErrors> snapshot = table.Snapshot();
+  ASSERT_EQ(1, snapshot.size());
+  EXPECT_EQ(-1, snapshot[0].errors[0].code);
+  EXPECT_EQ(1, snapshot[0].errors[0].count);
+}
+
+TEST_F(RecentErrorsTest, ConcurrentReaders) {
+  RecentErrorsTable table(4, 2);
+  SetRecentErrorsTable(&table);
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int i = 0; i != 10000; ++i) {
+      Check(absl::NotFoundError(std::string(1 + i % 3 * 40, 'a' + i % 3)))
+          .IgnoreError();
+    }
+    done = true;
+  });
+  // Every entry that is read must be one that has been written.
+  while (!done) {
+    for (const SiteRecentErrors& site : table.Snapshot()) {
+      for (const RecentError& err : site.errors) {
+        ASSERT_FALSE(err.message.empty());
+        ASSERT_EQ(std::string(err.message.size(), err.message[0]),
+                  err.message);
+      }
+    }
+  }
+  writer.join();
+}
+
+}  // namespace
+}  // namespace merror
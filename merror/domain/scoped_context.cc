@@ -0,0 +1,95 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "merror/domain/scoped_context.h"
+
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "merror/domain/internal/stringstream.h"
+
+namespace merror {
+
+thread_local const ScopedContext* ScopedContext::top_ = nullptr;
+
+void ScopedContext::PrintValue(std::ostream& strm) const {
+  switch (kind_) {
+    case Kind::kInt:
+      strm << value_.i;
+      break;
+    case Kind::kUint:
+      strm << value_.u;
+      break;
+    case Kind::kDouble:
+      strm << value_.d;
+      break;
+    case Kind::kString:
+      strm << std::string_view(value_.s.data, value_.s.size);
+      break;
+    case Kind::kObject:
+      value_.obj.print(strm, value_.obj.p);
+      break;
+  }
+}
+
+namespace internal_dynamic_context {
+
+namespace {
+
+// Prints `ctx` and the contexts below it, outermost first. Returns false if
+// nothing has been printed.
+bool Print(const ScopedContext* ctx, std::ostream& strm) {
+  if (!ctx) return false;
+  if (Print(ctx->prev(), strm)) strm << ", ";
+  strm << ctx->key() << '=';
+  ctx->PrintValue(strm);
+  return true;
+}
+
+// Returns true if `message` has a line that starts with `contexts` followed by
+// the end of the line or by more contexts.
+bool Lists(std::string_view message, std::string_view contexts) {
+  for (size_t pos = message.find(contexts); pos != std::string_view::npos;
+       pos = message.find(contexts, pos + 1)) {
+    if (pos != 0 && message[pos - 1] != '\n') continue;
+    std::string_view rest = message.substr(pos + contexts.size());
+    if (rest.empty() || rest[0] == '\n' || rest.substr(0, 2) == ", ") {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+std::string AppendContexts(std::string_view description,
+                           std::string_view culprit_message) {
+  std::string res(description);
+  const ScopedContext* top = ScopedContext::top();
+  if (!top) return res;
+  internal::StringStream strm(&res);
+  if (!res.empty()) strm << '\n';
+  size_t start = res.size();
+  strm << "Context: ";
+  Print(top, strm);
+  if (Lists(culprit_message, std::string_view(res).substr(start))) {
+    res.resize(description.size());
+  }
+  return res;
+}
+
+}  // namespace internal_dynamic_context
+}  // namespace merror
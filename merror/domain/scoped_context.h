@@ -0,0 +1,223 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `ScopedContext` and `DynamicContext`. A `ScopedContext` pushes a
+// key/value pair onto a thread-local stack for the duration of its scope. The
+// `DynamicContext` error domain extension appends the pairs that are on the
+// stack of the current thread to the policy description of every error, so
+// they show up in statuses and log records.
+//
+//   constexpr auto MErrorDomain =
+//       merror::Default().With(merror::DynamicContext());
+//
+//   Status HandleShard(int shard, const std::string& user) {
+//     merror::ScopedContext shard_ctx("shard", shard);
+//     merror::ScopedContext user_ctx("user", user);
+//     // On error the description contains "Context: shard=42, user=alice".
+//     MTRY(Process(shard));
+//     ...
+//   }
+//
+// Pushing and popping is a couple of pointer assignments: the value isn't
+// formatted and nothing is allocated until an error is detected. Arithmetic
+// values are copied into the `ScopedContext`. Strings and other values are
+// referred to by pointer, so they must outlive it. The latter are printed with
+// `operator<<`.
+//
+// The key must be a string with static storage duration.
+//
+// Contexts are appended where the error originates. When the culprit is an
+// error whose message already lists the contexts of the current thread, for
+// example because `MTRY()` propagates the error of a callee, they aren't
+// appended again.
+//
+// The stack is per thread. Contexts aren't carried over to other threads, and
+// a coroutine that is resumed on another thread sees the stack of that thread.
+// `ScopedContext` objects must be destroyed in the reverse order of their
+// construction, which is what scopes do.
+
+#ifndef MERROR_5EDA97_DOMAIN_SCOPED_CONTEXT_H_
+#define MERROR_5EDA97_DOMAIN_SCOPED_CONTEXT_H_
+
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "merror/domain/base.h"
+#include "merror/domain/defer.h"
+#include "merror/domain/description.h"
+
+namespace merror {
+
+namespace internal_scoped_context {
+
+// True if `ScopedContext` refers to values of type `T` by pointer and prints
+// them with `operator<<`.
+template <class T>
+constexpr bool kByPointer =
+    !std::is_arithmetic<T>::value &&
+    !std::is_convertible<const T&, std::string_view>::value;
+
+}  // namespace internal_scoped_context
+
+// Pushes a key/value pair onto the thread-local context stack. See comments at
+// the top of the file.
+class ScopedContext {
+ public:
+  template <class T, std::enable_if_t<std::is_integral<T>::value &&
+                                          std::is_signed<T>::value,
+                                      int> = 0>
+  ScopedContext(const char* key, T value) : ScopedContext(key, Kind::kInt) {
+    value_.i = value;
+  }
+
+  template <class T, std::enable_if_t<std::is_integral<T>::value &&
+                                          !std::is_signed<T>::value,
+                                      int> = 0>
+  ScopedContext(const char* key, T value) : ScopedContext(key, Kind::kUint) {
+    value_.u = value;
+  }
+
+  template <class T,
+            std::enable_if_t<std::is_floating_point<T>::value, int> = 0>
+  ScopedContext(const char* key, T value) : ScopedContext(key, Kind::kDouble) {
+    value_.d = value;
+  }
+
+  ScopedContext(const char* key, const char* value)
+      : ScopedContext(key, std::string_view(value)) {}
+
+  ScopedContext(const char* key, std::string_view value)
+      : ScopedContext(key, Kind::kString) {
+    value_.s = {value.data(), value.size()};
+  }
+
+  ScopedContext(const char* key, const std::string& value)
+      : ScopedContext(key, std::string_view(value)) {}
+
+  ScopedContext(const char* key, std::string&& value) = delete;
+
+  template <class T,
+            std::enable_if_t<internal_scoped_context::kByPointer<T>, int> = 0>
+  ScopedContext(const char* key, const T& value)
+      : ScopedContext(key, Kind::kObject) {
+    value_.obj = {&value, [](std::ostream& strm, const void* p) {
+                    strm << *static_cast<const T*>(p);
+                  }};
+  }
+
+  // Values are referred to by pointer, so temporaries would dangle.
+  template <class T,
+            std::enable_if_t<internal_scoped_context::kByPointer<T>, int> = 0>
+  ScopedContext(const char* key, const T&& value) = delete;
+
+  ~ScopedContext() { top_ = prev_; }
+
+  ScopedContext(const ScopedContext&) = delete;
+  ScopedContext& operator=(const ScopedContext&) = delete;
+
+  // The innermost context of the current thread or null.
+  static const ScopedContext* top() { return top_; }
+  // The context that was on top when this one was created or null.
+  const ScopedContext* prev() const { return prev_; }
+  const char* key() const { return key_; }
+
+  // Writes the value.
+  void PrintValue(std::ostream& strm) const;
+
+ private:
+  enum class Kind { kInt, kUint, kDouble, kString, kObject };
+
+  ScopedContext(const char* key, Kind kind)
+      : key_(key), kind_(kind), prev_(top_) {
+    top_ = this;
+  }
+
+  static thread_local const ScopedContext* top_;
+
+  const char* key_;
+  Kind kind_;
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+    struct {
+      const char* data;
+      size_t size;
+    } s;
+    struct {
+      const void* p;
+      void (*print)(std::ostream&, const void*);
+    } obj;
+  } value_;
+  const ScopedContext* prev_;
+};
+
+namespace internal_dynamic_context {
+
+// Returns `description` followed by the contexts of the current thread,
+// outermost first. Returns `description` if there are none, or if
+// `culprit_message` already lists them.
+std::string AppendContexts(std::string_view description,
+                           std::string_view culprit_message);
+
+// Returns the message of culprits such as `absl::Status` and
+// `absl::StatusOr<T>`, or else an empty string.
+template <class Culprit>
+auto CulpritMessage(const Culprit& culprit, int)
+    -> decltype(std::string_view(culprit.message())) {
+  return culprit.message();
+}
+
+template <class Culprit>
+auto CulpritMessage(const Culprit& culprit, long)
+    -> decltype(std::string_view(culprit.status().message())) {
+  return culprit.status().message();
+}
+
+template <class Culprit>
+std::string_view CulpritMessage(const Culprit&, unsigned) {
+  return {};
+}
+
+template <class Base>
+struct Policy : Base {
+  template <class Context, class Self = Policy>
+  auto GetErrorBuilder(Context&& ctx) const
+      -> decltype(AddAnnotation<PolicyDescriptionAnnotation>(
+          Defer<Self>(this)->Base::GetErrorBuilder(std::move(ctx)),
+          std::string())) {
+    static_assert(!std::is_reference<Context>::value, "");
+    auto builder = Base::GetErrorBuilder(std::move(ctx));
+    std::string description =
+        AppendContexts(merror::GetPolicyDescription(builder),
+                       CulpritMessage(builder.context().culprit, 0));
+    return AddAnnotation<PolicyDescriptionAnnotation>(std::move(builder),
+                                                      std::move(description));
+  }
+};
+
+}  // namespace internal_dynamic_context
+
+// Error domain extension that adds the contexts of the current thread to error
+// descriptions. See comments at the top of the file for details.
+using DynamicContext = Policy<internal_dynamic_context::Policy>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_SCOPED_CONTEXT_H_
@@ -0,0 +1,131 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/scoped_context.h"
+
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::testing::EndsWith;
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+constexpr auto MErrorDomain = Default()
+                                  .With(DynamicContext())
+                                  .DefaultErrorCode(absl::StatusCode::kUnknown);
+
+struct Point {
+  int x, y;
+  friend std::ostream& operator<<(std::ostream& strm, const Point& p) {
+    return strm << '(' << p.x << ", " << p.y << ')';
+  }
+};
+
+absl::Status Fail() {
+  MVERIFY(false);
+  return absl::OkStatus();
+}
+
+std::string FailMessage() { return std::string(Fail().message()); }
+
+TEST(ScopedContext, NoContext) {
+  EXPECT_EQ(nullptr, ScopedContext::top());
+  EXPECT_THAT(FailMessage(), Not(HasSubstr("Context")));
+}
+
+TEST(ScopedContext, Stack) {
+  std::string user = "alice";
+  Point p{1, 2};
+  {
+    ScopedContext shard("shard", -42);
+    ScopedContext u("user", user);
+    {
+      ScopedContext point("point", p);
+      ScopedContext ratio("ratio", 0.5);
+      ScopedContext id("id", uint64_t{7});
+      ScopedContext name("name", "bob");
+      EXPECT_THAT(FailMessage(),
+                  EndsWith("\nContext: shard=-42, user=alice, point=(1, 2), "
+                           "ratio=0.5, id=7, name=bob"));
+    }
+    // Values are printed when the error is detected.
+    user = "carol";
+    EXPECT_THAT(FailMessage(), EndsWith("\nContext: shard=-42, user=carol"));
+  }
+  EXPECT_EQ(nullptr, ScopedContext::top());
+}
+
+TEST(ScopedContext, PerThread) {
+  ScopedContext shard("shard", 1);
+  std::thread([] {
+    EXPECT_THAT(FailMessage(), Not(HasSubstr("Context")));
+  }).join();
+}
+
+TEST(ScopedContext, WithDescriptions) {
+  auto F = []() -> absl::Status {
+    constexpr auto MErrorDomain = merror::MErrorDomain << "policy";
+    MVERIFY(false) << "builder";
+    return absl::OkStatus();
+  };
+  ScopedContext shard("shard", 1);
+  EXPECT_THAT(std::string(F().message()),
+              HasSubstr("\npolicy\nContext: shard=1\nbuilder"));
+}
+
+TEST(ScopedContext, StatusCulprit) {
+  auto F = []() -> absl::Status {
+    MVERIFY(absl::NotFoundError("missing"));
+    return absl::OkStatus();
+  };
+  ScopedContext shard("shard", 1);
+  absl::Status s = F();
+  EXPECT_EQ(absl::StatusCode::kNotFound, s.code());
+  EXPECT_EQ("missing\nContext: shard=1", s.message());
+}
+
+absl::StatusOr<int> Inner() {
+  ScopedContext shard("shard", 1);
+  MVERIFY(false);
+  return 1;
+}
+
+absl::StatusOr<int> Middle() { return MTRY(Inner()) + 1; }
+
+absl::Status Outer() {
+  MTRY(Middle());
+  return absl::OkStatus();
+}
+
+TEST(ScopedContext, Propagation) {
+  ScopedContext user("user", "alice");
+  // The contexts are appended once, where the error originates.
+  std::string message(Outer().message());
+  EXPECT_THAT(message, EndsWith("\nContext: user=alice, shard=1"));
+  EXPECT_EQ(message.find("Context"), message.rfind("Context"));
+}
+
+}  // namespace
+}  // namespace merror
@@ -47,6 +47,10 @@
 //  Methods `NoDefaultErrorCode()` and `NoErrorCode()` can be used to remove
 //  previous defaults.
 //
+// Functions returning `absl::StatusCode` can use merror macros, too. The error
+// code is chosen the same way as for `Status`, but no description is built,
+// so nothing is allocated.
+//
 
 #ifndef MERROR_5EDA97_DOMAIN_STATUS_H_
 #define MERROR_5EDA97_DOMAIN_STATUS_H_
@@ -124,17 +128,21 @@ struct StatusBuilder {
   };
 };
 
-// Assembles description for Status for the case where the culprit doesn't have
-// a description.
+// Makes a Status with a description assembled for the case where the culprit
+// doesn't have one. The description is formatted into a scratch buffer, so the
+// only allocations are made by the Status.
 template <class Builder, class Culprit>
-std::string StatusDescription(const Builder& builder, const Culprit& culprit) {
-  internal::IndentingStream strm;
+absl::Status StatusWithDescription(absl::StatusCode code,
+                                   const Builder& builder,
+                                   const Culprit& culprit) {
+  const auto& ctx = builder.context();
+  internal::ScratchStream scratch;
+  internal::IndentingStream& strm = *scratch;
   auto WritePrefix = [&](std::string_view prefix) {
     strm.indent(0);
     strm << '\n' << prefix;
     strm.indent(prefix.size());
   };
-  const auto& ctx = builder.context();
   strm << ctx.file << ':' << ctx.line << ": ";
   bool has_headline = false;
   if (ctx.macro != Macro::kError) {
@@ -157,13 +165,17 @@ std::string StatusDescription(const Builder& builder, const Culprit& culprit) {
     strm << ctx.macro_str << '(' << ctx.rel_expr->left << ' '
          << ctx.rel_expr->op << ' ' << ctx.rel_expr->right << ')';
   }
+  if (ctx.index >= 0) {
+    WritePrefix("Index: ");
+    strm << ctx.index;
+  }
   // Print only printable non-boring culprits.
   if (CanPrint<Builder, Culprit>() && !std::is_empty<Culprit>()) {
     WritePrefix("Culprit: ");
     merror::TryPrint(builder, culprit, &strm);
     absl::StripTrailingAsciiWhitespace(&strm.str());
   }
-  return std::move(strm.str());
+  return absl::Status(code, strm.str());
 }
 
 struct StatusAcceptor {
@@ -199,15 +211,46 @@ struct AcceptStatus : Hook<Base> {
 };
 
 template <class Base>
-struct MakeStatus : Hook<Base> {
+struct MakeStatusCode : Hook<Base> {
   using Hook<Base>::MakeMError;
 
+  absl::StatusCode MakeMError(ResultType<absl::StatusCode>,
+                              const absl::StatusCode& culprit) const {
+    return GetAnnotationOr<ErrorCodeAnnotation>(*this, culprit);
+  }
+
+  absl::StatusCode MakeMError(ResultType<absl::StatusCode>,
+                              const absl::Status& culprit) const {
+    return GetAnnotationOr<ErrorCodeAnnotation>(*this, culprit.code());
+  }
+
+  template <class T>
+  absl::StatusCode MakeMError(ResultType<absl::StatusCode> r,
+                              const absl::StatusOr<T>& culprit) const {
+    return this->derived().MakeError(r, culprit.status());
+  }
+
+  template <class Culprit>
+  absl::StatusCode MakeMError(ResultType<absl::StatusCode>,
+                              const Culprit& culprit) const {
+    static_assert(HasAnnotation<DefaultErrorCodeAnnotation, Base>() ||
+                      HasAnnotation<ErrorCodeAnnotation, Base>(),
+                  "Use .ErrorCode() or .DefaultErrorCode() to set error code");
+    return GetAnnotationOr<ErrorCodeAnnotation>(
+        *this, GetAnnotationOr<DefaultErrorCodeAnnotation>(*this, Void()));
+  }
+};
+
+template <class Base>
+struct MakeStatus : MakeStatusCode<Base> {
+  using MakeStatusCode<Base>::MakeMError;
+
   absl::Status MakeMError(ResultType<absl::Status>,
                           const absl::StatusCode& culprit) const {
     absl::StatusCode code =
         GetAnnotationOr<ErrorCodeAnnotation>(*this, culprit);
-    return absl::Status(
-        code, internal_status::StatusDescription(this->derived(), Void()));
+    return internal_status::StatusWithDescription(code, this->derived(),
+                                                  Void());
   }
 
   absl::Status MakeMError(ResultType<absl::Status>,
@@ -230,7 +273,8 @@ struct MakeStatus : Hook<Base> {
     for (std::string_view& s : parts) s = absl::StripAsciiWhitespace(s);
     auto end = std::remove(std::begin(parts), std::end(parts), "");
     auto begin = std::begin(parts);
-    std::string message;
+    internal::ScratchStream scratch;
+    std::string& message = scratch->str();
     if (end != begin) {
       message = *begin;
       for (++begin; end != begin; ++begin) {
@@ -268,8 +312,7 @@ absl::Status Fallback(ResultType<absl::Status>,
                 "Use .ErrorCode() or .DefaultErrorCode() to set error code");
   const absl::StatusCode& code = GetAnnotationOr<ErrorCodeAnnotation>(
       b, GetAnnotationOr<DefaultErrorCodeAnnotation>(b, Void()));
-  return absl::Status(code,
-                      internal_status::StatusDescription(b.derived(), culprit));
+  return internal_status::StatusWithDescription(code, b.derived(), culprit);
 }
 
 template <class R, class Base, class Culprit>
@@ -298,8 +341,12 @@ using StatusBuilder = Domain<internal_status::StatusBuilder::Policy,
 // StatusOr arguments.
 using AcceptStatus = Policy<internal_status::AcceptStatus>;
 
+// Error domain extension that enables merror macros to return
+// `absl::StatusCode`. Unlike `MakeStatus`, it never allocates.
+using MakeStatusCode = Builder<internal_status::MakeStatusCode>;
+
 // Error domain extension that enables merror macros to return Status and
-// StatusOr when the culprit contains error code.
+// StatusOr when the culprit contains error code. Includes `MakeStatusCode`.
 using MakeStatus = Builder<internal_status::MakeStatus>;
 
 // Error domain extension that enables merror macros to return Status and
@@ -18,6 +18,7 @@
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -292,6 +293,18 @@ TEST(MakeStatus, DescriptionFromNothing) {
                           R"(.*status_test\.cc:[0-9]+: MVERIFY\(2 \+ 2 == 5\).)"
                           R"(Same as: MVERIFY\(4 == 5\))")));
   }
+  {
+    auto F = [](const std::vector<int>& v) -> absl::Status {
+      MVERIFY_EACH(v, _ < 5).ErrorCode(UNKNOWN);
+      return absl::OkStatus();
+    };
+    EXPECT_THAT(
+        F({1, 7, 9}),
+        StatusIs(UNKNOWN,
+                 MatchesRegex(
+                     R"(.*status_test\.cc:[0-9]+: MVERIFY_EACH\(v, _ < 5\).)"
+                     R"(Same as: MVERIFY_EACH\(7 < 5\).Index: 1)")));
+  }
 }
 
 TEST(MakeStatus, ErrorCodeFromStatus) {
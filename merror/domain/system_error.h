@@ -0,0 +1,392 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This library defines error domain extensions for dealing with errno-style
+// errors: `merror::Errno` and `std::error_code`. They are a part of
+// `merror::Default()`.
+//
+// `merror::Errno` wraps the return value of a function that returns a negative
+// value and sets `errno` on failure. `MTRY(Errno(rc))` evaluates to `rc` on
+// success. `merror::ErrnoPtr` does the same for functions that return a
+// pointer: `nullptr` on failure by default, or the value passed as the second
+// argument, such as `MAP_FAILED` for `mmap()`. `MTRY(ErrnoPtr(p))` evaluates
+// to `p` on success.
+//
+//   StatusOr<void*> MapFile(int fd, size_t size) {
+//     MERROR_DOMAIN(merror::Default);
+//     return MTRY(merror::ErrnoPtr(
+//         ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0), MAP_FAILED));
+//   }
+//
+// `MVERIFY()` and `MTRY()` also accept `std::error_code`, and `MTRY()` accepts
+// `std::pair<T, std::error_code>`, which evaluates to the `T` on success.
+//
+//   std::pair<size_t, std::error_code> ReadSome(Socket& s, char* buf,
+//                                               size_t n);
+//
+//   StatusOr<std::string> Read(Socket& s) {
+//     MERROR_DOMAIN(merror::Default);
+//     char buf[4096];
+//     size_t n = MTRY(ReadSome(s, buf, sizeof(buf)));
+//     return std::string(buf, n);
+//   }
+//
+//   StatusOr<size_t> ReadSome(int fd, char* buf, size_t n) {
+//     MERROR_DOMAIN(merror::Default);
+//     return MTRY(merror::Errno(::read(fd, buf, n)));
+//   }
+//
+//   Status Sync(int fd) {
+//     MERROR_DOMAIN(merror::Default);
+//     MVERIFY(merror::Errno(::fsync(fd))) << "fd=" << fd;
+//     return Status();
+//   }
+//
+// Interfaces that report failures as `-errno` rather than through `errno`, such
+// as io_uring completions, should use `Errno::FromNegated(res)`.
+//
+// The error code of the resulting `Status` is derived from the error number via
+// `ErrnoToStatusCode()` unless overridden with `ErrorCode()`. A failed call
+// that has left `errno` at zero yields `kUnknown`. The text of the
+// error number is rendered only when the error description is actually built.
+// Functions returning `absl::StatusCode` don't build descriptions at all, so
+// they can propagate errno-style errors without allocating.
+//
+//   absl::StatusCode WriteAll(int fd, const char* buf, size_t n) {
+//     MERROR_DOMAIN(merror::Default);
+//     while (n != 0) {
+//       ssize_t written = MTRY(merror::Errno(::write(fd, buf, n)));
+//       buf += written;
+//       n -= written;
+//     }
+//     return absl::StatusCode::kOk;
+//   }
+
+#ifndef MERROR_5EDA97_DOMAIN_SYSTEM_ERROR_H_
+#define MERROR_5EDA97_DOMAIN_SYSTEM_ERROR_H_
+
+#include <errno.h>
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <system_error>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "merror/domain/base.h"
+#include "merror/domain/method_hooks.h"
+#include "merror/domain/return.h"
+#include "merror/domain/status.h"
+
+namespace merror {
+
+// The result of a call that reports failures through errno. Captures `errno`
+// on construction if the call has failed.
+class Errno {
+ public:
+  // `rc` is the return value of a function that returns a negative value
+  // (usually -1) and sets `errno` on failure.
+  explicit Errno(long rc) : rc_(rc), code_(rc < 0 ? errno : 0) {}
+
+  // `res` is the return value of a function that returns `-errno` on failure.
+  static Errno FromNegated(long res) { return Errno(res, res < 0 ? -res : 0); }
+
+  bool ok() const { return rc_ >= 0; }
+
+  // The return value of the call.
+  long rc() const { return rc_; }
+
+  // The error number. Zero if the call has succeeded.
+  int code() const { return code_; }
+
+  friend std::ostream& operator<<(std::ostream& strm, const Errno& e) {
+    return strm << std::generic_category().message(e.code_) << " [errno "
+                << e.code_ << "]";
+  }
+
+ private:
+  Errno(long rc, long code) : rc_(rc), code_(static_cast<int>(code)) {}
+
+  long rc_;
+  int code_;
+};
+
+// The result of a call that returns a pointer and sets `errno` on failure.
+// Captures `errno` on construction if the call has failed.
+template <class T>
+class ErrnoPtr {
+ public:
+  // `p` is the return value of the call. `failed` is the value it returns on
+  // failure: `nullptr` for most functions, `MAP_FAILED` for `mmap()`.
+  explicit ErrnoPtr(T* p, T* failed = nullptr)
+      : p_(p), errno_(p == failed ? -1 : 0) {}
+
+  bool ok() const { return errno_.ok(); }
+
+  // The return value of the call.
+  T* get() const { return p_; }
+
+  // The error number. Zero if the call has succeeded.
+  int code() const { return errno_.code(); }
+
+  // The failure as `Errno`, with `rc()` -1.
+  const Errno& error() const { return errno_; }
+
+ private:
+  T* p_;
+  Errno errno_;
+};
+
+namespace internal_system_error {
+
+struct ErrnoMapping {
+  int errnum;
+  absl::StatusCode code;
+};
+
+// Only POSIX error numbers are listed. Everything else maps to kUnknown.
+constexpr ErrnoMapping kErrnoMappings[] = {
+    {0, absl::StatusCode::kOk},
+    {EINVAL, absl::StatusCode::kInvalidArgument},
+    {ENAMETOOLONG, absl::StatusCode::kInvalidArgument},
+    {E2BIG, absl::StatusCode::kInvalidArgument},
+    {EDESTADDRREQ, absl::StatusCode::kInvalidArgument},
+    {EDOM, absl::StatusCode::kInvalidArgument},
+    {EFAULT, absl::StatusCode::kInvalidArgument},
+    {EILSEQ, absl::StatusCode::kInvalidArgument},
+    {ENOPROTOOPT, absl::StatusCode::kInvalidArgument},
+    {ENOTSOCK, absl::StatusCode::kInvalidArgument},
+    {ENOTTY, absl::StatusCode::kInvalidArgument},
+    {EPROTOTYPE, absl::StatusCode::kInvalidArgument},
+    {ESPIPE, absl::StatusCode::kInvalidArgument},
+    {ETIMEDOUT, absl::StatusCode::kDeadlineExceeded},
+    {ENODEV, absl::StatusCode::kNotFound},
+    {ENOENT, absl::StatusCode::kNotFound},
+    {ENXIO, absl::StatusCode::kNotFound},
+    {ESRCH, absl::StatusCode::kNotFound},
+    {EEXIST, absl::StatusCode::kAlreadyExists},
+    {EADDRNOTAVAIL, absl::StatusCode::kAlreadyExists},
+    {EALREADY, absl::StatusCode::kAlreadyExists},
+    {EPERM, absl::StatusCode::kPermissionDenied},
+    {EACCES, absl::StatusCode::kPermissionDenied},
+    {EROFS, absl::StatusCode::kPermissionDenied},
+    {ENOTEMPTY, absl::StatusCode::kFailedPrecondition},
+    {EISDIR, absl::StatusCode::kFailedPrecondition},
+    {ENOTDIR, absl::StatusCode::kFailedPrecondition},
+    {EADDRINUSE, absl::StatusCode::kFailedPrecondition},
+    {EBADF, absl::StatusCode::kFailedPrecondition},
+    {EBUSY, absl::StatusCode::kFailedPrecondition},
+    {ECHILD, absl::StatusCode::kFailedPrecondition},
+    {EISCONN, absl::StatusCode::kFailedPrecondition},
+    {ENOTCONN, absl::StatusCode::kFailedPrecondition},
+    {EPIPE, absl::StatusCode::kFailedPrecondition},
+    {ETXTBSY, absl::StatusCode::kFailedPrecondition},
+    {ENOSPC, absl::StatusCode::kResourceExhausted},
+    {EMFILE, absl::StatusCode::kResourceExhausted},
+    {EMLINK, absl::StatusCode::kResourceExhausted},
+    {ENFILE, absl::StatusCode::kResourceExhausted},
+    {ENOBUFS, absl::StatusCode::kResourceExhausted},
+    {ENOMEM, absl::StatusCode::kResourceExhausted},
+    {EFBIG, absl::StatusCode::kOutOfRange},
+    {EOVERFLOW, absl::StatusCode::kOutOfRange},
+    {ERANGE, absl::StatusCode::kOutOfRange},
+    {ENOSYS, absl::StatusCode::kUnimplemented},
+    {ENOTSUP, absl::StatusCode::kUnimplemented},
+    {EAFNOSUPPORT, absl::StatusCode::kUnimplemented},
+    {EPROTONOSUPPORT, absl::StatusCode::kUnimplemented},
+    {EXDEV, absl::StatusCode::kUnimplemented},
+    {EAGAIN, absl::StatusCode::kUnavailable},
+    {ECONNREFUSED, absl::StatusCode::kUnavailable},
+    {ECONNABORTED, absl::StatusCode::kUnavailable},
+    {ECONNRESET, absl::StatusCode::kUnavailable},
+    {EINTR, absl::StatusCode::kUnavailable},
+    {EHOSTUNREACH, absl::StatusCode::kUnavailable},
+    {ENETDOWN, absl::StatusCode::kUnavailable},
+    {ENETRESET, absl::StatusCode::kUnavailable},
+    {ENETUNREACH, absl::StatusCode::kUnavailable},
+    {ENOLCK, absl::StatusCode::kUnavailable},
+    {EDEADLK, absl::StatusCode::kAborted},
+    {ESTALE, absl::StatusCode::kAborted},
+    {ECANCELED, absl::StatusCode::kCancelled},
+};
+
+constexpr size_t ErrnoTableSize() {
+  int max = 0;
+  for (const ErrnoMapping& m : kErrnoMappings) {
+    if (m.errnum > max) max = m.errnum;
+  }
+  return static_cast<size_t>(max) + 1;
+}
+
+// Dense table indexed by error number.
+constexpr std::array<absl::StatusCode, ErrnoTableSize()> MakeErrnoTable() {
+  std::array<absl::StatusCode, ErrnoTableSize()> table = {};
+  for (absl::StatusCode& code : table) code = absl::StatusCode::kUnknown;
+  for (const ErrnoMapping& m : kErrnoMappings) table[m.errnum] = m.code;
+  return table;
+}
+
+constexpr std::array<absl::StatusCode, ErrnoTableSize()> kErrnoTable =
+    MakeErrnoTable();
+
+}  // namespace internal_system_error
+
+// Maps an error number to the closest `absl::StatusCode`. Zero maps to `kOk`;
+// unknown error numbers map to `kUnknown`.
+constexpr absl::StatusCode ErrnoToStatusCode(int errnum) {
+  return errnum >= 0 && static_cast<size_t>(errnum) <
+                            internal_system_error::kErrnoTable.size()
+             ? internal_system_error::kErrnoTable[errnum]
+             : absl::StatusCode::kUnknown;
+}
+
+namespace internal_system_error {
+
+inline bool IsErrnoCategory(const std::error_code& ec) {
+  return ec.category() == std::generic_category() ||
+         ec.category() == std::system_category();
+}
+
+// Streams the message of an error code. Used as a culprit when building the
+// description of the error, so that the message is rendered only when needed.
+struct ErrorCodeText {
+  friend std::ostream& operator<<(std::ostream& strm, const ErrorCodeText& t) {
+    return strm << t.ec.message() << " [" << t.ec.category().name() << ':'
+                << t.ec.value() << ']';
+  }
+  const std::error_code& ec;
+};
+
+struct ErrnoAcceptor {
+  bool IsError() const { return !e.ok(); }
+  long GetValue() && { return e.rc(); }
+  Errno GetCulprit() && { return e; }
+  const Errno& e;
+};
+
+template <class T>
+struct ErrnoPtrAcceptor {
+  bool IsError() const { return !p.ok(); }
+  T* GetValue() && { return p.get(); }
+  Errno GetCulprit() && { return p.error(); }
+  const ErrnoPtr<T>& p;
+};
+
+struct ErrorCodeAcceptor {
+  bool IsError() const { return static_cast<bool>(ec); }
+  Void GetValue() && { return {}; }
+  const std::error_code& GetCulprit() && { return ec; }
+  const std::error_code& ec;
+};
+
+template <class Pair>
+struct ValueOrErrorCodeAcceptor {
+  Pair&& pair;
+  bool IsError() const { return static_cast<bool>(pair.second); }
+  auto GetValue() && -> decltype((std::forward<Pair>(pair).first)) {
+    return std::forward<Pair>(pair).first;
+  }
+  const std::error_code& GetCulprit() && { return pair.second; }
+};
+
+template <class Base>
+struct AcceptSystemError : Hook<Base> {
+  using Hook<Base>::MVerify;
+  using Hook<Base>::MTry;
+
+  template <class R>
+  ErrnoAcceptor MVerify(Ref<R, Errno> val) const {
+    return {val.Get()};
+  }
+
+  template <class R>
+  ErrnoAcceptor MTry(Ref<R, Errno> val) const {
+    return {val.Get()};
+  }
+
+  template <class R, class T>
+  ErrnoPtrAcceptor<T> MVerify(Ref<R, ErrnoPtr<T>> val) const {
+    return {val.Get()};
+  }
+
+  template <class R, class T>
+  ErrnoPtrAcceptor<T> MTry(Ref<R, ErrnoPtr<T>> val) const {
+    return {val.Get()};
+  }
+
+  template <class R>
+  ErrorCodeAcceptor MVerify(Ref<R, std::error_code> val) const {
+    return {val.Get()};
+  }
+
+  template <class R>
+  ErrorCodeAcceptor MTry(Ref<R, std::error_code> val) const {
+    return {val.Get()};
+  }
+
+  template <class R, class T>
+  ValueOrErrorCodeAcceptor<R> MTry(
+      Ref<R, std::pair<T, std::error_code>> val) const {
+    return {val.Forward()};
+  }
+};
+
+template <class Base>
+struct MakeSystemError : Hook<Base> {
+  using Hook<Base>::MakeMError;
+
+  absl::Status MakeMError(ResultType<absl::Status>,
+                          const Errno& culprit) const {
+    return internal_status::StatusWithDescription(
+        this->derived().MakeError(ResultType<absl::StatusCode>(), culprit),
+        this->derived(), culprit);
+  }
+
+  absl::Status MakeMError(ResultType<absl::Status>,
+                          const std::error_code& culprit) const {
+    return internal_status::StatusWithDescription(
+        this->derived().MakeError(ResultType<absl::StatusCode>(), culprit),
+        this->derived(), ErrorCodeText{culprit});
+  }
+
+  absl::StatusCode MakeMError(ResultType<absl::StatusCode>,
+                              const Errno& culprit) const {
+    // A failed call that hasn't set `errno` is still an error.
+    absl::StatusCode code = ErrnoToStatusCode(culprit.code());
+    if (code == absl::StatusCode::kOk) code = absl::StatusCode::kUnknown;
+    return GetAnnotationOr<ErrorCodeAnnotation>(*this, code);
+  }
+
+  absl::StatusCode MakeMError(ResultType<absl::StatusCode>,
+                              const std::error_code& culprit) const {
+    return GetAnnotationOr<ErrorCodeAnnotation>(
+        *this, IsErrnoCategory(culprit) ? ErrnoToStatusCode(culprit.value())
+                                        : absl::StatusCode::kUnknown);
+  }
+};
+
+}  // namespace internal_system_error
+
+// Error domain extension that enables merror macros to accept `Errno`,
+// `ErrnoPtr`, `std::error_code` and `std::pair<T, std::error_code>` arguments.
+using AcceptSystemError = Policy<internal_system_error::AcceptSystemError>;
+
+// Error domain extension that enables merror macros to build `Status` and
+// `StatusCode` from `Errno` and `std::error_code` culprits.
+using MakeSystemError = Builder<internal_system_error::MakeSystemError>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_SYSTEM_ERROR_H_
@@ -0,0 +1,216 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "merror/domain/system_error.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/domain/description.h"
+#include "merror/domain/method_hooks.h"
+#include "merror/domain/print.h"
+#include "merror/domain/return.h"
+#include "merror/domain/status.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::absl::StatusCode;
+using ::testing::HasSubstr;
+
+constexpr auto MErrorDomain = EmptyDomain().With(
+    MethodHooks(), Return(), Print(), DescriptionBuilder(), StatusBuilder(),
+    AcceptStatus(), MakeStatus(), AcceptSystemError(), MakeSystemError());
+
+// Returns `rc` with `errno` set to `errnum`, like a failed syscall.
+long Syscall(long rc, int errnum) {
+  errno = errnum;
+  return rc;
+}
+
+TEST(ErrnoToStatusCode, Mapping) {
+  static_assert(ErrnoToStatusCode(0) == StatusCode::kOk, "");
+  static_assert(ErrnoToStatusCode(ENOENT) == StatusCode::kNotFound, "");
+  EXPECT_EQ(StatusCode::kInvalidArgument, ErrnoToStatusCode(EINVAL));
+  EXPECT_EQ(StatusCode::kPermissionDenied, ErrnoToStatusCode(EACCES));
+  EXPECT_EQ(StatusCode::kUnavailable, ErrnoToStatusCode(EAGAIN));
+  EXPECT_EQ(StatusCode::kUnavailable, ErrnoToStatusCode(EINTR));
+  EXPECT_EQ(StatusCode::kResourceExhausted, ErrnoToStatusCode(ENOMEM));
+  EXPECT_EQ(StatusCode::kUnknown, ErrnoToStatusCode(-1));
+  EXPECT_EQ(StatusCode::kUnknown, ErrnoToStatusCode(1 << 20));
+}
+
+TEST(Errno, CapturesErrno) {
+  Errno ok(Syscall(5, ENOENT));
+  EXPECT_TRUE(ok.ok());
+  EXPECT_EQ(5, ok.rc());
+  EXPECT_EQ(0, ok.code());
+  Errno err(Syscall(-1, ENOENT));
+  EXPECT_FALSE(err.ok());
+  EXPECT_EQ(-1, err.rc());
+  EXPECT_EQ(ENOENT, err.code());
+}
+
+TEST(Errno, FromNegated) {
+  EXPECT_TRUE(Errno::FromNegated(3).ok());
+  Errno err = Errno::FromNegated(-EAGAIN);
+  EXPECT_FALSE(err.ok());
+  EXPECT_EQ(EAGAIN, err.code());
+}
+
+TEST(Errno, TryReturnsStatus) {
+  auto F = [](long rc, int errnum) -> absl::StatusOr<long> {
+    return MTRY(Errno(Syscall(rc, errnum))) + 1;
+  };
+  EXPECT_EQ(8, *F(7, 0));
+  absl::Status s = F(-1, ENOENT).status();
+  EXPECT_EQ(StatusCode::kNotFound, s.code());
+  EXPECT_THAT(std::string(s.message()),
+              HasSubstr(std::generic_category().message(ENOENT)));
+  EXPECT_THAT(std::string(s.message()), HasSubstr("MTRY"));
+}
+
+TEST(Errno, VerifyWithErrorCode) {
+  auto F = [](long rc) -> absl::Status {
+    MVERIFY(Errno(Syscall(rc, EIO))).ErrorCode(StatusCode::kDataLoss)
+        << "fsync";
+    return absl::OkStatus();
+  };
+  EXPECT_TRUE(F(0).ok());
+  absl::Status s = F(-1);
+  EXPECT_EQ(StatusCode::kDataLoss, s.code());
+  EXPECT_THAT(std::string(s.message()), HasSubstr("fsync"));
+}
+
+TEST(Errno, ReturnStatusCode) {
+  auto F = [](long rc, int errnum) -> StatusCode {
+    MTRY(Errno::FromNegated(Syscall(rc, errnum)));
+    return StatusCode::kOk;
+  };
+  EXPECT_EQ(StatusCode::kOk, F(0, 0));
+  EXPECT_EQ(StatusCode::kUnavailable, F(-EAGAIN, 0));
+  EXPECT_EQ(StatusCode::kFailedPrecondition, F(-EBADF, 0));
+}
+
+TEST(Errno, FailureWithoutErrno) {
+  // Errors never turn into OK, even if the call hasn't set `errno`.
+  auto F = [](long rc) -> absl::Status {
+    MVERIFY(Errno(Syscall(rc, 0)));
+    return absl::OkStatus();
+  };
+  EXPECT_EQ(StatusCode::kUnknown, F(-1).code());
+  auto G = [](long rc) -> StatusCode {
+    MTRY(Errno(Syscall(rc, 0)));
+    return StatusCode::kOk;
+  };
+  EXPECT_EQ(StatusCode::kUnknown, G(-1));
+  EXPECT_EQ(StatusCode::kOk, G(0));
+}
+
+TEST(ErrnoPtr, Mmap) {
+  auto F = [](size_t size) -> absl::StatusOr<void*> {
+    return MTRY(ErrnoPtr(mmap(nullptr, size, PROT_READ,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0),
+                         MAP_FAILED));
+  };
+  absl::StatusOr<void*> p = F(4096);
+  ASSERT_TRUE(p.ok());
+  EXPECT_NE(MAP_FAILED, *p);
+  munmap(*p, 4096);
+  // Mapping zero bytes fails with EINVAL.
+  absl::Status s = F(0).status();
+  EXPECT_EQ(StatusCode::kInvalidArgument, s.code());
+  EXPECT_THAT(std::string(s.message()),
+              HasSubstr(std::generic_category().message(EINVAL)));
+}
+
+TEST(ErrnoPtr, Null) {
+  auto F = [](const char* path) -> absl::Status {
+    FILE* f = MTRY(ErrnoPtr(fopen(path, "r")), _ << path);
+    fclose(f);
+    return absl::OkStatus();
+  };
+  EXPECT_TRUE(F("/dev/null").ok());
+  absl::Status s = F("/nonexistent/file");
+  EXPECT_EQ(StatusCode::kNotFound, s.code());
+  EXPECT_THAT(std::string(s.message()), HasSubstr("/nonexistent/file"));
+  auto G = [](int* p, int errnum) -> StatusCode {
+    errno = errnum;
+    MVERIFY(ErrnoPtr(p));
+    return StatusCode::kOk;
+  };
+  int x = 0;
+  EXPECT_EQ(StatusCode::kOk, G(&x, EBADF));
+  EXPECT_EQ(StatusCode::kFailedPrecondition, G(nullptr, EBADF));
+}
+
+TEST(ErrorCode, Try) {
+  auto F = [](std::error_code ec) -> StatusCode {
+    MTRY(ec);
+    return StatusCode::kOk;
+  };
+  EXPECT_EQ(StatusCode::kOk, F({}));
+  EXPECT_EQ(StatusCode::kUnavailable,
+            F(std::make_error_code(std::errc::resource_unavailable_try_again)));
+}
+
+TEST(ErrorCode, TryPair) {
+  auto F = [](int n, std::errc err) -> absl::StatusOr<int> {
+    return MTRY(std::make_pair(n, std::make_error_code(err))) + 1;
+  };
+  EXPECT_EQ(8, *F(7, std::errc()));
+  absl::Status s = F(7, std::errc::no_such_file_or_directory).status();
+  EXPECT_EQ(StatusCode::kNotFound, s.code());
+  std::pair<std::string, std::error_code> p("abc", std::error_code());
+  auto G = [&]() -> absl::StatusOr<std::string> { return MTRY(p) + "d"; };
+  EXPECT_EQ("abcd", *G());
+}
+
+TEST(ErrorCode, Verify) {
+  auto F = [](std::error_code ec) -> absl::Status {
+    MVERIFY(ec);
+    return absl::OkStatus();
+  };
+  EXPECT_TRUE(F({}).ok());
+  absl::Status s = F(std::make_error_code(std::errc::permission_denied));
+  EXPECT_EQ(StatusCode::kPermissionDenied, s.code());
+  EXPECT_THAT(
+      std::string(s.message()),
+      HasSubstr(std::make_error_code(std::errc::permission_denied).message()));
+}
+
+TEST(ErrorCode, NonErrnoCategory) {
+  auto F = [](std::error_code ec) -> StatusCode {
+    MVERIFY(ec);
+    return StatusCode::kOk;
+  };
+  EXPECT_EQ(StatusCode::kUnknown,
+            F(std::make_error_code(std::io_errc::stream)));
+  EXPECT_EQ(StatusCode::kAlreadyExists,
+            F(std::make_error_code(std::errc::file_exists)));
+}
+
+}  // namespace
+}  // namespace merror
@@ -0,0 +1,140 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "merror/domain/timed.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include "absl/time/time.h"
+
+namespace merror {
+
+namespace {
+
+// Latencies below `kLinear` nanoseconds have a bucket each. Above that, every
+// power of two is split into `1 << kSubBits` buckets.
+constexpr int kLinear = 16;
+constexpr int kLinearBits = 4;
+constexpr int kSubBits = 2;
+// Latencies of `1 << kMaxBits` nanoseconds and more go into the last bucket.
+constexpr int kMaxBits =
+    kLinearBits + ((LatencyHistogram::kNumBuckets - kLinear) >> kSubBits);
+
+int BucketIndex(int64_t nanos) {
+  if (nanos < kLinear) return nanos < 0 ? 0 : static_cast<int>(nanos);
+  int msb = 63 - __builtin_clzll(static_cast<uint64_t>(nanos));
+  if (msb >= kMaxBits) return LatencyHistogram::kNumBuckets - 1;
+  int sub = static_cast<int>(nanos >> (msb - kSubBits)) & ((1 << kSubBits) - 1);
+  return kLinear + ((msb - kLinearBits) << kSubBits) + sub;
+}
+
+void Snapshot(const std::atomic<uint64_t>* buckets, LatencyHistogram& h) {
+  for (int i = 0; i != LatencyHistogram::kNumBuckets; ++i) {
+    h.counts[i] = buckets[i].load(std::memory_order_relaxed);
+  }
+}
+
+// The head of the list of registered sites.
+std::atomic<internal_timed::SiteStats*> sites{nullptr};
+
+}  // namespace
+
+absl::Duration LatencyHistogram::BucketLowerBound(int i) {
+  if (i < kLinear) return absl::Nanoseconds(i);
+  int msb = kLinearBits + ((i - kLinear) >> kSubBits);
+  int64_t sub = (i - kLinear) & ((1 << kSubBits) - 1);
+  return absl::Nanoseconds(((int64_t{1} << kSubBits) + sub)
+                           << (msb - kSubBits));
+}
+
+uint64_t LatencyHistogram::total() const {
+  uint64_t res = 0;
+  for (uint64_t n : counts) res += n;
+  return res;
+}
+
+absl::Duration LatencyHistogram::Quantile(double q) const {
+  uint64_t n = total();
+  if (n == 0) return absl::ZeroDuration();
+  // The nearest rank.
+  uint64_t rank = static_cast<uint64_t>(std::ceil(q * n));
+  if (rank == 0) rank = 1;
+  if (rank > n) rank = n;
+  uint64_t seen = 0;
+  for (int i = 0; i != kNumBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank) return BucketLowerBound(i);
+  }
+  return BucketLowerBound(kNumBuckets - 1);
+}
+
+std::vector<SiteLatency> GetLatencies() {
+  std::vector<SiteLatency> res;
+  for (const internal_timed::SiteStats* s =
+           sites.load(std::memory_order_acquire);
+       s; s = s->next) {
+    res.emplace_back();
+    SiteLatency& site = res.back();
+    site.file = s->file;
+    site.line = s->line;
+    Snapshot(s->ok, site.ok);
+    Snapshot(s->error, site.error);
+  }
+  return res;
+}
+
+std::vector<ErrorProneSite> FindErrorProneSites(double min_error_rate,
+                                                uint64_t min_samples) {
+  std::vector<ErrorProneSite> res;
+  for (const SiteLatency& site : GetLatencies()) {
+    uint64_t errors = site.error.total();
+    uint64_t samples = site.ok.total() + errors;
+    if (samples == 0 || samples < min_samples) continue;
+    double error_rate = static_cast<double>(errors) / samples;
+    if (error_rate < min_error_rate) continue;
+    res.push_back({site.file, site.line, samples, error_rate});
+  }
+  std::sort(res.begin(), res.end(),
+            [](const ErrorProneSite& a, const ErrorProneSite& b) {
+              return a.error_rate > b.error_rate;
+            });
+  return res;
+}
+
+namespace internal_timed {
+
+void Register(SiteStats& stats, const char* file, int line) {
+  if (stats.registered.exchange(true, std::memory_order_relaxed)) return;
+  stats.file = file;
+  stats.line = line;
+  SiteStats* head = sites.load(std::memory_order_relaxed);
+  do {
+    stats.next = head;
+  } while (!sites.compare_exchange_weak(head, &stats, std::memory_order_release,
+                                        std::memory_order_relaxed));
+}
+
+void Record(SiteStats& stats, bool error, int64_t nanos) {
+  (error ? stats.error : stats.ok)[BucketIndex(nanos)].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+}  // namespace internal_timed
+}  // namespace merror
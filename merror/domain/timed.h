@@ -0,0 +1,259 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `Timed`. This error domain extension adds method `Timed(sampler)` to
+// the policy. When it's called, `MTRY()` and `MVERIFY()` sites that use the
+// policy time the evaluation of their argument whenever `sampler()` returns
+// true. The latencies are recorded into per-site histograms, separately for
+// successes and errors.
+//
+//   const auto MErrorDomain = merror::Default()
+//                                 .With(merror::Timed())
+//                                 .Timed(merror::OneIn(100));
+//
+//   Status Handle(const Request& req) {
+//     Response resp = MTRY(CallBackend(req));
+//     ...
+//   }
+//
+//   for (const merror::SiteLatency& site : merror::GetLatencies()) {
+//     std::cout << site.file << ":" << site.line << " p99="
+//               << site.ok.Quantile(0.99) << "\n";
+//   }
+//
+// The sampler can be any copyable object that can be stored in a constexpr
+// policy and is callable as `bool(site)` or `bool()`. `site` is an object of a
+// type unique to the file and line of the macro, as in `ShouldShortCircuit()`
+// in //merror/macros.h. `OneIn(n)` samples every n-th evaluation of each site
+// on each thread.
+//
+// The timer is `std::chrono::steady_clock`. It's started right before the
+// argument of the macro is evaluated and stopped once the macro knows whether
+// the argument is an error, so the time spent building the error isn't
+// included. `MVERIFY_ALL()` and `MVERIFY_EACH()` aren't timed.
+//
+// Histograms are log-linear: latencies below 16ns have a bucket each, and
+// every power of two above that is split into 4 buckets, so the relative error
+// of a quantile is at most 25%. Recording is lock-free: a sampled evaluation
+// costs two clock reads and a relaxed atomic increment. Evaluations that
+// aren't sampled cost a call to the sampler.
+//
+// A site is identified by the file name and the line number, so several macros
+// on the same line share histograms. A site appears in `GetLatencies()` once
+// its first evaluation has been sampled.
+//
+// Since errors and successes are sampled alike, the histograms also estimate
+// the error rate of each site. `FindErrorProneSites()` lists the sites that
+// fail often enough to be worth tagging with `ExpectErrors()`.
+//
+// `Untimed()` removes the sampler from the policy.
+
+#ifndef MERROR_5EDA97_DOMAIN_TIMED_H_
+#define MERROR_5EDA97_DOMAIN_TIMED_H_
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "absl/time/time.h"
+#include "merror/domain/base.h"
+#include "merror/domain/defer.h"
+
+namespace merror {
+
+// A snapshot of the latency distribution at a single site.
+struct LatencyHistogram {
+  static constexpr int kNumBuckets = 192;
+
+  // The smallest latency that falls into bucket `i`.
+  static absl::Duration BucketLowerBound(int i);
+
+  // The number of recorded latencies.
+  uint64_t total() const;
+
+  // Returns the lower bound of the bucket that contains the q-quantile, where
+  // `q` is in [0, 1]. Returns zero if the histogram is empty.
+  absl::Duration Quantile(double q) const;
+
+  std::array<uint64_t, kNumBuckets> counts = {};
+};
+
+struct SiteLatency {
+  const char* file;
+  int line;
+  // Evaluations that the macro has accepted.
+  LatencyHistogram ok;
+  // Evaluations that the macro has treated as errors.
+  LatencyHistogram error;
+};
+
+// Returns the histograms of all sites that have been timed so far. Safe to call
+// concurrently with timing.
+std::vector<SiteLatency> GetLatencies();
+
+// A site whose sampled evaluations fail often enough that it should probably
+// be tagged with `ExpectErrors()` (see //merror/domain/expect_errors.h).
+struct ErrorProneSite {
+  const char* file;
+  int line;
+  // The number of sampled evaluations.
+  uint64_t samples;
+  // The fraction of sampled evaluations that were errors.
+  double error_rate;
+};
+
+// Returns the sites timed so far with at least `min_samples` sampled
+// evaluations, of which at least `min_error_rate` were errors. The most
+// error-prone sites come first.
+//
+//   for (const merror::ErrorProneSite& site : merror::FindErrorProneSites()) {
+//     std::cout << site.file << ":" << site.line << ": "
+//               << 100 * site.error_rate << "% errors\n";
+//   }
+std::vector<ErrorProneSite> FindErrorProneSites(double min_error_rate = 0.1,
+                                                uint64_t min_samples = 1000);
+
+namespace internal_timed {
+
+// The number of calls to skip before the next sample, per site and thread.
+template <class Site>
+inline thread_local uint32_t countdown = 0;
+
+}  // namespace internal_timed
+
+// Sampler that returns true on every n-th call for each site on each thread.
+// `OneIn(1)` times every evaluation, `OneIn(0)` none.
+class OneIn {
+ public:
+  constexpr explicit OneIn(uint32_t n) : n_(n) {}
+
+  template <class Site>
+  ABSL_ATTRIBUTE_ALWAYS_INLINE bool operator()(Site) const {
+    uint32_t& countdown = internal_timed::countdown<Site>;
+    if (ABSL_PREDICT_TRUE(countdown != 0)) {
+      --countdown;
+      return false;
+    }
+    if (n_ == 0) return false;
+    countdown = n_ - 1;
+    return true;
+  }
+
+ private:
+  uint32_t n_;
+};
+
+namespace internal_timed {
+
+struct TimedAnnotation {};
+
+// The histograms of a single site.
+struct SiteStats {
+  std::atomic<bool> registered{false};
+  const char* file = nullptr;
+  int line = 0;
+  // The next registered site.
+  SiteStats* next = nullptr;
+  std::atomic<uint64_t> ok[LatencyHistogram::kNumBuckets] = {};
+  std::atomic<uint64_t> error[LatencyHistogram::kNumBuckets] = {};
+};
+
+template <class Site>
+inline SiteStats site_stats;
+
+// Adds the site to the list returned by `GetLatencies()`. Idempotent.
+void Register(SiteStats& stats, const char* file, int line);
+
+void Record(SiteStats& stats, bool error, int64_t nanos);
+
+inline int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+class Timer {
+ public:
+  Timer() = default;
+  explicit Timer(SiteStats* stats) : stats_(stats), start_(Now()) {}
+
+  ABSL_ATTRIBUTE_ALWAYS_INLINE void Stop(bool error) {
+    if (ABSL_PREDICT_FALSE(stats_ != nullptr)) {
+      Record(*stats_, error, Now() - start_);
+    }
+  }
+
+ private:
+  SiteStats* stats_ = nullptr;
+  int64_t start_ = 0;
+};
+
+// Calls `sampler(site)` if the sampler takes a site, or else `sampler()`.
+template <class Sampler, class Site>
+ABSL_ATTRIBUTE_ALWAYS_INLINE inline auto Sample(const Sampler& sampler,
+                                                Site site, int)
+    -> decltype(static_cast<bool>(sampler(site))) {
+  return sampler(site);
+}
+
+template <class Sampler, class Site>
+ABSL_ATTRIBUTE_ALWAYS_INLINE inline bool Sample(const Sampler& sampler, Site,
+                                                unsigned) {
+  return sampler();
+}
+
+template <class Base>
+struct Policy : Base {
+  template <class Sampler>
+  constexpr auto Timed(Sampler sampler) const {
+    return AddAnnotation<TimedAnnotation>(*this, sampler);
+  }
+
+  template <class X = void>
+  constexpr auto Untimed() const
+      -> decltype(RemoveAnnotations<TimedAnnotation>(Defer<X>(*this))) {
+    return RemoveAnnotations<TimedAnnotation>(*this);
+  }
+
+  template <class Site>
+  ABSL_ATTRIBUTE_ALWAYS_INLINE Timer StartTimer(Site site) const {
+    if constexpr (HasAnnotation<TimedAnnotation, Base>()) {
+      if (ABSL_PREDICT_FALSE(
+              Sample(GetAnnotation<TimedAnnotation>(*this), site, 0))) {
+        SiteStats& stats = site_stats<Site>;
+        if (ABSL_PREDICT_FALSE(
+                !stats.registered.load(std::memory_order_relaxed))) {
+          Register(stats, site.file, site.line);
+        }
+        return Timer(&stats);
+      }
+    }
+    return Timer();
+  }
+};
+
+}  // namespace internal_timed
+
+// Error domain extension that adds `Timed()` to the policy. See comments at the
+// top of the file for details.
+using Timed = Policy<internal_timed::Policy>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_TIMED_H_
@@ -0,0 +1,190 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/timed.h"
+
+#include <string.h>
+
+#include <optional>
+#include <thread>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::absl::StatusCode;
+
+constexpr auto MErrorDomain = Default()
+                                  .DefaultErrorCode(StatusCode::kUnknown)
+                                  .With(Timed())
+                                  .Timed(OneIn(1));
+
+// Returns the histograms of the site on the given line of this file.
+std::optional<SiteLatency> Find(int line) {
+  for (const SiteLatency& site : GetLatencies()) {
+    if (site.line == line && strcmp(site.file, __FILE__) == 0) return site;
+  }
+  return std::nullopt;
+}
+
+absl::StatusOr<int> Sleep(absl::StatusOr<int> x) {
+  absl::SleepFor(absl::Milliseconds(1));
+  return x;
+}
+
+constexpr int kTryLine = __LINE__ + 2;
+absl::StatusOr<int> Try(absl::StatusOr<int> x) {
+  return MTRY(Sleep(x)) + 1;
+}
+
+constexpr int kVerifyLine = __LINE__ + 2;
+absl::Status Verify(bool x) {
+  MVERIFY(x);
+  return absl::OkStatus();
+}
+
+constexpr int kSampledLine = __LINE__ + 3;
+absl::StatusOr<int> Sampled(absl::StatusOr<int> x) {
+  constexpr auto MErrorDomain = merror::MErrorDomain.Timed(OneIn(3));
+  return MTRY(x) + 1;
+}
+
+constexpr int kAlternateLine1 = __LINE__ + 4;
+constexpr int kAlternateLine2 = __LINE__ + 4;
+absl::StatusOr<int> Alternate(absl::StatusOr<int> x) {
+  constexpr auto MErrorDomain = merror::MErrorDomain.Timed(OneIn(2));
+  int a = MTRY(x);
+  int b = MTRY(x);
+  return a + b;
+}
+
+constexpr int kUntimedLine = __LINE__ + 3;
+absl::StatusOr<int> Untimed(absl::StatusOr<int> x) {
+  constexpr auto MErrorDomain = merror::MErrorDomain.Untimed();
+  return MTRY(x) + 1;
+}
+
+constexpr int kProbeLine = __LINE__ + 2;
+absl::StatusOr<int> Probe(absl::StatusOr<int> x) {
+  return MTRY(x) + 1;
+}
+
+bool IsErrorProne(int line, double min_error_rate, uint64_t min_samples) {
+  for (const ErrorProneSite& site :
+       FindErrorProneSites(min_error_rate, min_samples)) {
+    if (site.line == line && strcmp(site.file, __FILE__) == 0) return true;
+  }
+  return false;
+}
+
+TEST(Timed, Try) {
+  EXPECT_EQ(2, *Try(1));
+  EXPECT_EQ(3, *Try(2));
+  EXPECT_EQ(StatusCode::kNotFound, Try(absl::NotFoundError("")).status().code());
+  std::optional<SiteLatency> site = Find(kTryLine);
+  ASSERT_TRUE(site);
+  EXPECT_EQ(2, site->ok.total());
+  EXPECT_EQ(1, site->error.total());
+  EXPECT_GE(site->ok.Quantile(0), absl::Microseconds(750));
+  EXPECT_GE(site->error.Quantile(0.5), absl::Microseconds(750));
+}
+
+TEST(Timed, Verify) {
+  EXPECT_TRUE(Verify(true).ok());
+  EXPECT_FALSE(Verify(false).ok());
+  EXPECT_FALSE(Verify(false).ok());
+  std::optional<SiteLatency> site = Find(kVerifyLine);
+  ASSERT_TRUE(site);
+  EXPECT_EQ(1, site->ok.total());
+  EXPECT_EQ(2, site->error.total());
+}
+
+TEST(Timed, Sampled) {
+  // Sample counters are per thread.
+  std::thread([] {
+    for (int i = 0; i != 9; ++i) EXPECT_EQ(2, *Sampled(1));
+  }).join();
+  std::optional<SiteLatency> site = Find(kSampledLine);
+  ASSERT_TRUE(site);
+  EXPECT_EQ(3, site->ok.total());
+  EXPECT_EQ(0, site->error.total());
+}
+
+TEST(Timed, SampledPerSite) {
+  // Sites that alternate on the same thread are sampled independently.
+  std::thread([] {
+    for (int i = 0; i != 4; ++i) EXPECT_EQ(2, *Alternate(1));
+  }).join();
+  for (int line : {kAlternateLine1, kAlternateLine2}) {
+    std::optional<SiteLatency> site = Find(line);
+    ASSERT_TRUE(site) << line;
+    EXPECT_EQ(2, site->ok.total()) << line;
+  }
+}
+
+TEST(Timed, Untimed) {
+  EXPECT_EQ(2, *Untimed(1));
+  EXPECT_FALSE(Find(kUntimedLine));
+}
+
+TEST(Timed, FindErrorProneSites) {
+  for (int i = 0; i != 100; ++i) {
+    static_cast<void>(
+        Probe(i % 5 < 2 ? absl::NotFoundError("") : absl::StatusOr<int>(i)));
+  }
+  EXPECT_TRUE(IsErrorProne(kProbeLine, 0.4, 100));
+  EXPECT_FALSE(IsErrorProne(kProbeLine, 0.5, 100));
+  EXPECT_FALSE(IsErrorProne(kProbeLine, 0.1, 101));
+  for (const ErrorProneSite& site : FindErrorProneSites(0.4, 100)) {
+    if (site.line != kProbeLine) continue;
+    EXPECT_EQ(100, site.samples);
+    EXPECT_DOUBLE_EQ(0.4, site.error_rate);
+  }
+}
+
+TEST(LatencyHistogram, Buckets) {
+  for (int i = 0; i != 17; ++i) {
+    EXPECT_EQ(absl::Nanoseconds(i), LatencyHistogram::BucketLowerBound(i));
+  }
+  EXPECT_EQ(absl::Nanoseconds(20), LatencyHistogram::BucketLowerBound(17));
+  EXPECT_EQ(absl::Nanoseconds(28), LatencyHistogram::BucketLowerBound(19));
+  EXPECT_EQ(absl::Nanoseconds(32), LatencyHistogram::BucketLowerBound(20));
+  for (int i = 1; i != LatencyHistogram::kNumBuckets; ++i) {
+    EXPECT_LT(LatencyHistogram::BucketLowerBound(i - 1),
+              LatencyHistogram::BucketLowerBound(i));
+  }
+}
+
+TEST(LatencyHistogram, Quantile) {
+  LatencyHistogram h;
+  EXPECT_EQ(0, h.total());
+  EXPECT_EQ(absl::ZeroDuration(), h.Quantile(0.5));
+  h.counts[3] = 1;
+  h.counts[20] = 2;
+  h.counts[21] = 1;
+  EXPECT_EQ(4, h.total());
+  EXPECT_EQ(absl::Nanoseconds(3), h.Quantile(0));
+  EXPECT_EQ(absl::Nanoseconds(3), h.Quantile(0.25));
+  EXPECT_EQ(absl::Nanoseconds(32), h.Quantile(0.5));
+  EXPECT_EQ(absl::Nanoseconds(40), h.Quantile(1));
+}
+
+}  // namespace
+}  // namespace merror
@@ -0,0 +1,57 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "merror/domain/tracepoints.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "absl/status/status.h"
+
+#ifdef __has_include
+#if __has_include(<sys/sdt.h>)
+#define MERROR_INTERNAL_HAVE_SDT 1
+#endif
+#endif
+
+#ifdef MERROR_INTERNAL_HAVE_SDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+// Tracers find the semaphore through the probe note and increment it in
+// memory.
+__attribute__((section(".probes")))
+#endif
+volatile unsigned short merror_error_semaphore = 0;  // NOLINT
+
+namespace merror {
+namespace internal_tracepoints {
+
+void Fire(uintptr_t location_id, const char* file, int line,
+          const absl::Status* status) {
+#ifdef MERROR_INTERNAL_HAVE_SDT
+  int code = status ? static_cast<int>(status->code()) : -1;
+  const char* message = status ? status->message().data() : nullptr;
+  size_t size = status ? status->message().size() : 0;
+  STAP_PROBE6(merror, error, location_id, file, line, code, message, size);
+#else
+  static_cast<void>(location_id);
+  static_cast<void>(file);
+  static_cast<void>(line);
+  static_cast<void>(status);
+#endif
+}
+
+}  // namespace internal_tracepoints
+}  // namespace merror
@@ -0,0 +1,102 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `Tracepoints`. This error domain extension fires the USDT probe
+// `merror:error` whenever an error is returned, so that tools like bpftrace and
+// perf can observe errors of a running process.
+//
+//   const auto MErrorDomain = merror::Default().With(merror::Tracepoints());
+//
+//   $ bpftrace -e 'usdt:./server:merror:error {
+//       printf("%s:%d %s\n", str(arg1), arg2, str(arg4, arg5)); }'
+//
+// The probe has the following arguments:
+//
+//   arg0  uint64       `Context::location_id` of the macro.
+//   arg1  const char*  The file name of the macro.
+//   arg2  int          The line number of the macro.
+//   arg3  int          The status code or -1 if there is no status.
+//   arg4  const char*  The status message. Not null-terminated.
+//   arg5  uint64       The size of the status message.
+//
+// The status is taken from the return value if it's `absl::Status` or
+// `absl::StatusOr<T>`, or else from the culprit if it's `absl::Status`.
+//
+// The probe is guarded by a semaphore, which is only nonzero while a tracer is
+// attached. Otherwise the cost of the extension is a single load and a branch
+// per error, and none of the arguments are computed.
+//
+// The probe is available where <sys/sdt.h> is. Elsewhere the extension does
+// nothing.
+
+#ifndef MERROR_5EDA97_DOMAIN_TRACEPOINTS_H_
+#define MERROR_5EDA97_DOMAIN_TRACEPOINTS_H_
+
+#include <stdint.h>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "merror/domain/base.h"
+#include "merror/domain/observer.h"
+
+// Incremented by tracers attached to `merror:error`. The name is dictated by
+// <sys/sdt.h>.
+extern volatile unsigned short merror_error_semaphore;  // NOLINT
+
+namespace merror {
+
+namespace internal_tracepoints {
+
+inline const absl::Status* AsStatus(const absl::Status& status) {
+  return &status;
+}
+
+template <class T>
+const absl::Status* AsStatus(const absl::StatusOr<T>& status_or) {
+  return &status_or.status();
+}
+
+template <class T>
+const absl::Status* AsStatus(const T&) {
+  return nullptr;
+}
+
+// Fires the probe. `status` may be null.
+void Fire(uintptr_t location_id, const char* file, int line,
+          const absl::Status* status);
+
+template <class Base>
+struct Builder : Observer<Base> {
+  template <class RetVal>
+  void ObserveRetVal(const RetVal& ret_val) {
+    if (ABSL_PREDICT_FALSE(merror_error_semaphore != 0)) {
+      const auto& ctx = this->context();
+      const absl::Status* status = AsStatus(ret_val);
+      if (!status) status = AsStatus(ctx.culprit);
+      Fire(ctx.location_id, ctx.file, ctx.line, status);
+    }
+    Observer<Base>::ObserveRetVal(ret_val);
+  }
+};
+
+}  // namespace internal_tracepoints
+
+// Error domain extension that fires a USDT probe on errors. See comments at
+// the top of the file for details.
+using Tracepoints = Builder<internal_tracepoints::Builder>;
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_DOMAIN_TRACEPOINTS_H_
@@ -0,0 +1,174 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/domain/tracepoints.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/macros.h"
+
+#if defined(__linux__) && defined(__ELF__) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define MERROR_TEST_HAVE_SDT 1
+#include <elf.h>
+#include <link.h>
+#endif
+#endif
+
+namespace merror {
+namespace {
+
+using ::absl::StatusCode;
+
+constexpr auto MErrorDomain =
+    Default().DefaultErrorCode(StatusCode::kUnknown).With(Tracepoints());
+
+absl::Status Verify(bool b) {
+  MVERIFY(b).ErrorCode(StatusCode::kInvalidArgument);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<int> Try(absl::StatusOr<int> x) { return MTRY(x) + 1; }
+
+// The return value isn't a status, so the culprit is traced.
+bool VerifyBool(absl::Status s) {
+  MVERIFY(s).Return(false);
+  return true;
+}
+
+class TracepointsTest : public ::testing::TestWithParam<bool> {
+ protected:
+  // Pretends that a tracer is attached.
+  TracepointsTest() { merror_error_semaphore = GetParam(); }
+  ~TracepointsTest() override { merror_error_semaphore = 0; }
+};
+
+TEST_P(TracepointsTest, ErrorsAreUnchanged) {
+  EXPECT_TRUE(Verify(true).ok());
+  EXPECT_EQ(StatusCode::kInvalidArgument, Verify(false).code());
+  EXPECT_EQ(2, *Try(1));
+  EXPECT_EQ(StatusCode::kNotFound,
+            Try(absl::NotFoundError("")).status().code());
+  EXPECT_TRUE(VerifyBool(absl::OkStatus()));
+  EXPECT_FALSE(VerifyBool(absl::AbortedError("")));
+}
+
+INSTANTIATE_TEST_SUITE_P(Attached, TracepointsTest, ::testing::Bool());
+
+#ifdef MERROR_TEST_HAVE_SDT
+
+// A USDT probe as described by its note in the binary.
+struct ProbeNote {
+  std::string provider;
+  std::string name;
+  std::string args;
+  // The link-time address of the semaphore.
+  uint64_t semaphore;
+};
+
+// Parses the `.note.stapsdt` section of the running binary.
+std::vector<ProbeNote> ReadProbeNotes() {
+  std::ifstream file("/proc/self/exe", std::ios::binary);
+  std::string elf((std::istreambuf_iterator<char>(file)),
+                  std::istreambuf_iterator<char>());
+  std::vector<ProbeNote> res;
+  if (elf.size() < sizeof(ElfW(Ehdr))) return res;
+  const auto* eh = reinterpret_cast<const ElfW(Ehdr)*>(elf.data());
+  const auto* sections =
+      reinterpret_cast<const ElfW(Shdr)*>(elf.data() + eh->e_shoff);
+  const char* section_names = elf.data() + sections[eh->e_shstrndx].sh_offset;
+  auto align = [](size_t n) { return (n + 3) & ~size_t{3}; };
+  for (size_t i = 0; i != eh->e_shnum; ++i) {
+    const ElfW(Shdr)& sh = sections[i];
+    if (strcmp(section_names + sh.sh_name, ".note.stapsdt") != 0) continue;
+    size_t pos = sh.sh_offset;
+    const size_t end = pos + sh.sh_size;
+    while (pos + sizeof(ElfW(Nhdr)) <= end) {
+      const auto* nh = reinterpret_cast<const ElfW(Nhdr)*>(elf.data() + pos);
+      const char* owner = elf.data() + pos + sizeof(*nh);
+      const char* desc = owner + align(nh->n_namesz);
+      pos = desc - elf.data() + align(nh->n_descsz);
+      // The description starts with the addresses of the probe, of
+      // `.stapsdt.base` and of the semaphore.
+      if (nh->n_type != 3 || strcmp(owner, "stapsdt") != 0) continue;
+      ElfW(Addr) addrs[3];
+      memcpy(addrs, desc, sizeof(addrs));
+      ProbeNote note;
+      note.semaphore = addrs[2];
+      const char* str = desc + sizeof(addrs);
+      note.provider = str;
+      str += note.provider.size() + 1;
+      note.name = str;
+      str += note.name.size() + 1;
+      note.args = str;
+      res.push_back(note);
+    }
+  }
+  return res;
+}
+
+// Returns the difference between run-time and link-time addresses of the
+// running binary.
+uintptr_t LoadBias() {
+  uintptr_t bias = 0;
+  dl_iterate_phdr(
+      [](dl_phdr_info* info, size_t, void* data) {
+        // The first object is the binary.
+        *static_cast<uintptr_t*>(data) = info->dlpi_addr;
+        return 1;
+      },
+      &bias);
+  return bias;
+}
+
+TEST(Tracepoints, ProbeNote) {
+  std::vector<ProbeNote> notes;
+  for (const ProbeNote& note : ReadProbeNotes()) {
+    if (note.provider == "merror" && note.name == "error") {
+      notes.push_back(note);
+    }
+  }
+  // The probe may be inlined into more than one place.
+  ASSERT_FALSE(notes.empty());
+  for (const ProbeNote& note : notes) {
+    // Tracers attach by incrementing the semaphore at this address.
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(&merror_error_semaphore),
+              note.semaphore + LoadBias());
+    std::istringstream args(note.args);
+    std::vector<std::string> operands{std::istream_iterator<std::string>(args),
+                                      std::istream_iterator<std::string>()};
+    EXPECT_EQ(6, operands.size()) << note.args;
+  }
+}
+
+#else  // MERROR_TEST_HAVE_SDT
+
+TEST(Tracepoints, ProbeNote) { GTEST_SKIP() << "<sys/sdt.h> isn't available"; }
+
+#endif  // MERROR_TEST_HAVE_SDT
+
+}  // namespace
+}  // namespace merror
@@ -0,0 +1,74 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `Task<T>`, a minimal eager coroutine type for testing and
+// benchmarking MCO_ERROR, MCO_VERIFY and MCO_TRY. The body runs to completion
+// on construction and the result is stored in the promise. Requires C++20.
+//
+//   merror::internal::Task<StatusOr<int>> Parse(std::string s) {
+//     MCO_VERIFY(!s.empty());
+//     co_return static_cast<int>(s.size());
+//   }
+//
+//   StatusOr<int> n = Parse("42").Get();
+//
+// A `Task` can also be `co_await`ed from another coroutine.
+
+#ifndef MERROR_5EDA97_INTERNAL_COROUTINE_TASK_H_
+#define MERROR_5EDA97_INTERNAL_COROUTINE_TASK_H_
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace merror {
+namespace internal {
+
+template <class T>
+class Task {
+ public:
+  struct promise_type {
+    std::optional<T> value;
+
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_value(const T& v) { value.emplace(v); }
+    void return_value(T&& v) { value.emplace(std::move(v)); }
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  Task(Task&& other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+  ~Task() {
+    if (h_) h_.destroy();
+  }
+
+  bool await_ready() const noexcept { return true; }
+  void await_suspend(std::coroutine_handle<>) const noexcept {}
+  T await_resume() { return std::move(*h_.promise().value); }
+
+  T Get() && { return std::move(*h_.promise().value); }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> h) : h_(h) {}
+  std::coroutine_handle<promise_type> h_;
+};
+
+}  // namespace internal
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_INTERNAL_COROUTINE_TASK_H_
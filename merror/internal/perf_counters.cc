@@ -0,0 +1,148 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/internal/perf_counters.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace merror {
+namespace internal {
+namespace {
+
+bool Enabled() {
+  static const bool enabled = [] {
+    const char* env = getenv("MERROR_PERF_COUNTERS");
+    return env && *env && strcmp(env, "0") != 0;
+  }();
+  return enabled;
+}
+
+void WarnUnavailable(int err) {
+  static const bool warned = [&] {
+    fprintf(stderr,
+            "MERROR_PERF_COUNTERS: hardware counters are unavailable (%s); "
+            "check kernel.perf_event_paranoid\n",
+            strerror(err));
+    return true;
+  }();
+  static_cast<void>(warned);
+}
+
+#if defined(__linux__)
+
+struct Event {
+  const char* name;
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr Event kEvents[] = {
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"l1i_misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1I | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+         PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+int Open(const Event& e) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = e.type;
+  attr.config = e.config;
+  attr.disabled = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, /*pid=*/0,
+                                  /*cpu=*/-1, /*group_fd=*/-1,
+                                  PERF_FLAG_FD_CLOEXEC));
+}
+
+#endif  // defined(__linux__)
+
+}  // namespace
+
+PerfCounters::PerfCounters() {
+  for (int& fd : fds_) fd = -1;
+  if (!Enabled()) return;
+#if defined(__linux__)
+  static_assert(sizeof(kEvents) / sizeof(kEvents[0]) == kNumEvents, "");
+  int err = 0;
+  bool any = false;
+  for (int i = 0; i != kNumEvents; ++i) {
+    fds_[i] = Open(kEvents[i]);
+    if (fds_[i] < 0) {
+      err = errno;
+    } else {
+      any = true;
+    }
+  }
+  if (!any) {
+    WarnUnavailable(err);
+    return;
+  }
+  for (int fd : fds_) {
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+  }
+  for (int fd : fds_) {
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#else
+  WarnUnavailable(ENOSYS);
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+  for (int fd : fds_) {
+    if (fd >= 0) close(fd);
+  }
+#endif
+}
+
+void PerfCounters::Report(benchmark::State& state, int64_t ops_per_iteration) {
+#if defined(__linux__)
+  for (int fd : fds_) {
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (int i = 0; i != kNumEvents; ++i) {
+    if (fds_[i] < 0) continue;
+    // value, time enabled, time running.
+    uint64_t buf[3];
+    if (read(fds_[i], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0) {
+      continue;
+    }
+    double value = static_cast<double>(buf[0]) * buf[1] / buf[2];
+    state.counters[kEvents[i].name] = benchmark::Counter(
+        value / ops_per_iteration, benchmark::Counter::kAvgIterations);
+  }
+#endif
+}
+
+}  // namespace internal
+}  // namespace merror
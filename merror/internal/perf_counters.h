@@ -0,0 +1,77 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `PerfCounters`, which collects hardware performance counters in
+// benchmarks with perf_event_open(2): retired instructions, branch misses, L1
+// instruction cache misses and last-level cache misses. Cycle counts alone
+// don't tell whether a change to the macro expansion helped branch prediction
+// or instruction cache behavior; these do.
+//
+//   void BM_Foo(benchmark::State& state) {
+//     merror::internal::PerfCounters perf;
+//     for (auto _ : state) {
+//       ...
+//     }
+//     perf.Report(state);
+//   }
+//
+// Collection is opt-in: it's enabled by setting the `MERROR_PERF_COUNTERS`
+// environment variable to a value other than "0".
+//
+//   $ MERROR_PERF_COUNTERS=1 bazel run -c opt //merror:macros_benchmark
+//
+// Counters are reported per iteration as `instructions`, `branch_misses`,
+// `l1i_misses` and `cache_misses`. They count user-space events of the calling
+// thread and of the threads it starts after the construction of
+// `PerfCounters`. If the kernel multiplexes counters, values are scaled by the
+// fraction of time they were running.
+//
+// Counters that can't be opened are silently omitted. If none can be opened,
+// for example on non-Linux systems, in containers without access to the PMU
+// or with `kernel.perf_event_paranoid` above 2, a warning is printed once and
+// the benchmarks run as usual.
+
+#ifndef MERROR_5EDA97_INTERNAL_PERF_COUNTERS_H_
+#define MERROR_5EDA97_INTERNAL_PERF_COUNTERS_H_
+
+#include <stdint.h>
+
+#include "benchmark/benchmark.h"
+
+namespace merror {
+namespace internal {
+
+class PerfCounters {
+ public:
+  // Starts counting if collection is enabled and counters are available.
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // Stops counting and adds the counters to `state`, divided by the number of
+  // iterations times `ops_per_iteration`.
+  void Report(benchmark::State& state, int64_t ops_per_iteration = 1);
+
+ private:
+  static constexpr int kNumEvents = 4;
+  // Negative for counters that aren't open.
+  int fds_[kNumEvents];
+};
+
+}  // namespace internal
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_INTERNAL_PERF_COUNTERS_H_
@@ -76,6 +76,19 @@
 #define MERROR_INTERNAL_IF(COND, THEN, ELSE) \
   MERROR_INTERNAL_VCAT(MERROR_INTERNAL_IF_, COND)(THEN, ELSE)
 
+// Applies `M` to every argument and concatenates the results.
+//
+//   #define F(x) [x]
+//
+//   MERROR_INTERNAL_FOR_EACH(F, a, b, c) => [a] [b] [c]
+//
+// Requires: there are between 1 and 32 arguments. Between 33 and 64 arguments
+// produce a compilation error that says so.
+#define MERROR_INTERNAL_FOR_EACH(M, ...)                    \
+  MERROR_INTERNAL_VCAT(MERROR_INTERNAL_FOR_EACH_,           \
+                       MERROR_INTERNAL_NARG32(__VA_ARGS__)) \
+  (M, __VA_ARGS__)
+
 ///////////////////////////////////////////////////////////////////////////////
 //                   IMPLEMENTATION DETAILS FOLLOW                           //
 //                    DO NOT USE FROM OTHER FILES                            //
@@ -111,4 +124,89 @@
   MERROR_INTERNAL_HAS_COMMA(                   \
       MERROR_INTERNAL_CAT5(MERROR_INTERNAL_IS_EMPTY_CASE_, A, B, C, D))
 
+// Helpers for `MERROR_INTERNAL_FOR_EACH`.
+// `MERROR_INTERNAL_NARG32` expands to the number of arguments, or to
+// `TOO_MANY` if there are between 33 and 64 of them.
+#define MERROR_INTERNAL_NARG32(...)                                            \
+  MERROR_INTERNAL_65TH(                                                        \
+      __VA_ARGS__, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, \
+      TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY,    \
+      TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY,    \
+      TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY,    \
+      TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, TOO_MANY, 32, 31, 30, 29, 28,    \
+      27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10,  \
+      9, 8, 7, 6, 5, 4, 3, 2, 1)
+#define MERROR_INTERNAL_65TH(                                                  \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16,    \
+    _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, \
+    _32, _33, _34, _35, _36, _37, _38, _39, _40, _41, _42, _43, _44, _45, _46, \
+    _47, _48, _49, _50, _51, _52, _53, _54, _55, _56, _57, _58, _59, _60, _61, \
+    _62, _63, _64, X, ...)                                                     \
+  X
+#define MERROR_INTERNAL_FOR_EACH_TOO_MANY(M, ...) \
+  _Pragma("GCC error \"too many arguments: at most 32 are supported\"")
+#define MERROR_INTERNAL_FOR_EACH_1(M, a) M(a)
+#define MERROR_INTERNAL_FOR_EACH_2(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_1(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_3(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_2(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_4(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_3(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_5(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_4(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_6(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_5(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_7(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_6(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_8(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_7(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_9(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_8(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_10(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_9(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_11(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_10(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_12(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_11(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_13(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_12(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_14(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_13(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_15(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_14(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_16(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_15(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_17(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_16(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_18(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_17(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_19(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_18(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_20(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_19(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_21(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_20(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_22(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_21(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_23(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_22(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_24(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_23(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_25(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_24(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_26(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_25(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_27(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_26(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_28(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_27(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_29(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_28(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_30(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_29(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_31(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_30(M, __VA_ARGS__)
+#define MERROR_INTERNAL_FOR_EACH_32(M, a, ...) \
+  M(a) MERROR_INTERNAL_FOR_EACH_31(M, __VA_ARGS__)
+
 #endif  // MERROR_5EDA97_INTERNAL_PREPROCESSOR_H_
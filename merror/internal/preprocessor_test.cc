@@ -50,6 +50,46 @@ TEST(Preprocessor, Vcat) {
       "xy", MERROR_INTERNAL_STRINGIZE(MERROR_INTERNAL_VCAT(MERROR_TEST_PAIR)));
 }
 
+#define MERROR_TEST_BRACKET(x) [x]
+
+TEST(Preprocessor, ForEach) {
+  EXPECT_STREQ("[a]", MERROR_INTERNAL_STRINGIZE(
+                          MERROR_INTERNAL_FOR_EACH(MERROR_TEST_BRACKET, a)));
+  EXPECT_STREQ("[a] [b] [c]",
+               MERROR_INTERNAL_STRINGIZE(MERROR_INTERNAL_FOR_EACH(
+                   MERROR_TEST_BRACKET, a, b, c)));
+  EXPECT_STREQ("[x] [y]", MERROR_INTERNAL_STRINGIZE(MERROR_INTERNAL_FOR_EACH(
+                              MERROR_TEST_BRACKET, MERROR_TEST_PAIR)));
+  EXPECT_STREQ(
+      "[1] [2] [3] [4] [5] [6] [7] [8] [9] [10] [11] [12] [13] [14] [15] [16] "
+      "[17] [18] [19] [20] [21] [22] [23] [24] [25] [26] [27] [28] [29] [30] "
+      "[31] [32]",
+      MERROR_INTERNAL_STRINGIZE(MERROR_INTERNAL_FOR_EACH(
+          MERROR_TEST_BRACKET, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+          15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+          32)));
+}
+
+TEST(Preprocessor, Narg32) {
+  EXPECT_EQ(1, MERROR_INTERNAL_NARG32(a));
+  EXPECT_EQ(3, MERROR_INTERNAL_NARG32(a, b, c));
+  EXPECT_EQ(32, MERROR_INTERNAL_NARG32(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+                                       13, 14, 15, 16, 17, 18, 19, 20, 21, 22,
+                                       23, 24, 25, 26, 27, 28, 29, 30, 31, 32));
+  EXPECT_STREQ("TOO_MANY",
+               MERROR_INTERNAL_STRINGIZE(MERROR_INTERNAL_NARG32(
+                   1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17,
+                   18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32,
+                   33)));
+  EXPECT_STREQ(
+      "TOO_MANY",
+      MERROR_INTERNAL_STRINGIZE(MERROR_INTERNAL_NARG32(
+          1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
+          20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36,
+          37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53,
+          54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64)));
+}
+
 TEST(Preprocessor, StartsWithUnderscore) {
   EXPECT_FALSE(MERROR_INTERNAL_STARTS_WITH_UNDERSCORE_TOKEN());
   EXPECT_FALSE(MERROR_INTERNAL_STARTS_WITH_UNDERSCORE_TOKEN(1));
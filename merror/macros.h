@@ -23,6 +23,9 @@
 //     evaluates to the value extracted from `expr`. `MTRY(expr)` behaves as
 //     `expr` in all non-error contexts.
 //
+// It also defines their counterparts for C++20 coroutines: MCO_ERROR,
+// MCO_VERIFY and MCO_TRY. They use `co_return` instead of `return`.
+//
 // The macros use the Error Domain to determine if a given expression produced
 // an error, build an error to return, or extract the value from the expression.
 //
@@ -69,6 +72,47 @@
 //   // The result can be a reference. It can alias `ctx`.
 //   ErrorBuilder GetErrorBuilder(merror::Context<Macro, Culprit>&& ctx) const;
 //
+// The following methods are optional:
+//
+//   // Called by `MVERIFY()` and `MTRY()` after the acceptor has reported
+//   // success. `Site` is a type unique to the file and line of the macro.
+//   // `site.file` is `__FILE__`, `site.line` is `__LINE__`. If it returns
+//   // true, the macro takes the error path nevertheless, with the culprit
+//   // returned by `InjectedCulprit()` instead of the one of the acceptor. See
+//   // //util/merror/domain/fault_injection.h.
+//   template <class Site>
+//   bool ShouldInjectFault(Site site) const;
+//
+//   // Must be present if `ShouldInjectFault()` is. `MTRY()` passes the result
+//   // as the culprit. `MVERIFY()` converts it to the type of its regular
+//   // culprit, or value-initializes the latter if it's an empty tag such as
+//   // `std::false_type`. Sites of `MVERIFY()` where neither is possible don't
+//   // call `ShouldInjectFault()`.
+//   InjectedCulprit InjectedCulprit() const;
+//
+//   // Called by `MTRY()` before evaluating its argument. `Site` is the same
+//   // as above. If it returns true, the argument isn't evaluated, and
+//   // `MTRY()` fails with the culprit returned by `ShortCircuitCulprit()`.
+//   // See //util/merror/domain/circuit_breaker.h.
+//   template <class Site>
+//   bool ShouldShortCircuit(Site site) const;
+//
+//   // Must be present if `ShouldShortCircuit()` is.
+//   template <class Site>
+//   Culprit ShortCircuitCulprit(Site site) const;
+//
+//   // Called by `MTRY()` after its argument has been evaluated. `error` is
+//   // true if the macro is going to fail.
+//   template <class Site>
+//   void ObserveOutcome(Site site, bool error) const;
+//
+//   // Called by `MVERIFY()` and `MTRY()` right before evaluating the argument.
+//   // `Site` is the same as above. The macro calls `timer.Stop(error)` right
+//   // after the acceptor has reported whether the argument is an error. See
+//   // //util/merror/domain/timed.h.
+//   template <class Site>
+//   Timer StartTimer(Site site) const;
+//
 // `VerifyAcceptor`, the result type of `Verify()`, must have the following
 // methods:
 //
@@ -208,7 +252,10 @@
 #ifndef MERROR_5EDA97_MACROS_H_
 #define MERROR_5EDA97_MACROS_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <initializer_list>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -279,9 +326,62 @@
 //   }
 //
 // See comments at the top of the file for more info.
-#define MVERIFY(...)                                                      \
-  MERROR_INTERNAL_MVERIFY_IMPL("MVERIFY", #__VA_ARGS__, (MErrorDomain()), \
-                               __VA_ARGS__)
+#define MVERIFY(...)                                            \
+  MERROR_INTERNAL_MVERIFY_IMPL(return, "MVERIFY", #__VA_ARGS__, \
+                               (MErrorDomain()), __VA_ARGS__)
+
+// Verifies several boolean conditions at once. If any of them is false,
+// returns an error as if by `MVERIFY()` of the first false condition.
+//
+//   Status ParseRequest(const Request& req) {
+//     constexpr MERROR_DOMAIN(merror::Default);
+//     MVERIFY_ALL(req.offset >= 0, req.size >= 0, req.size <= kMaxSize,
+//                 req.offset + req.size <= req.limit)
+//         .ErrorCode(INVALID_ARGUMENT);
+//     ...
+//   }
+//
+// All conditions are evaluated, without short-circuiting, and combined into a
+// bitmask. Only a single branch on the combined result is taken on the happy
+// path. On failure the first false condition is evaluated once more to
+// describe it, so conditions must be cheap and free of side effects.
+//
+// Every condition must be of type `bool`. There can be at most 32 of them;
+// passing more is a compilation error.
+//
+// A builder patch can follow the macro, just like with `MVERIFY()`. It applies
+// to whichever condition has failed.
+#define MVERIFY_ALL(...)                                                    \
+  MERROR_INTERNAL_MVERIFY_ALL_IMPL(return, "MVERIFY_ALL", (MErrorDomain()), \
+                                   __VA_ARGS__)
+
+// Verifies that every element of a range satisfies a boolean predicate. Within
+// the predicate `_` refers to the element. If some element doesn't satisfy it,
+// returns an error as if by `MVERIFY()` of the predicate applied to the first
+// such element.
+//
+//   Status Gather(const std::vector<int>& indices, int size) {
+//     constexpr MERROR_DOMAIN(merror::Default);
+//     MVERIFY_EACH(indices, _ >= 0).ErrorCode(INVALID_ARGUMENT);
+//     MVERIFY_EACH(indices, _ < size).ErrorCode(OUT_OF_RANGE);
+//     ...
+//   }
+//
+// The error context carries the index of the offending element, and the
+// description mentions both the index and the operands, e.g.
+// `MVERIFY_EACH(7 < 5)` and `Index: 3`.
+//
+// Random access ranges are checked in fixed-size blocks. Within a block the
+// predicate is evaluated for every element without branching, which allows the
+// compiler to vectorize the loop. A block is scanned for the first failing
+// element only if it has failed as a whole. Hence the predicate must be cheap
+// and free of side effects. It must be of type `bool`. Other ranges are checked
+// element by element.
+//
+// A builder patch can follow the macro, just like with `MVERIFY()`.
+#define MVERIFY_EACH(...)                                                 \
+  MERROR_INTERNAL_MVERIFY_EACH_IMPL(return, "MVERIFY_EACH", #__VA_ARGS__, \
+                                    (MErrorDomain()), __VA_ARGS__)
 
 // If the specified expression is an error, returns an error (possibly of
 // different type than the passed expression). Otherwise evaluates to the value
@@ -315,6 +415,104 @@
   MERROR_INTERNAL_APPLY_VARIADIC(MERROR_INTERNAL_MTRY_, "MTRY", #__VA_ARGS__, \
                                  (MErrorDomain()), __VA_ARGS__)
 
+// Debug-only versions of `MVERIFY()` and `MTRY()` for invariants in hot code.
+// When `MERROR_DEBUG_VERIFY` is 1, they behave exactly like their regular
+// counterparts. When it's 0, `MDVERIFY()` compiles to nothing: neither its
+// argument nor its builder patch is evaluated, although both are still
+// compiled, so they can't rot. `MDTRY()` evaluates its argument and extracts
+// the value without checking for errors. Its builder patch is compiled but
+// never evaluated.
+//
+// WARNING: with `MERROR_DEBUG_VERIFY` set to 0, passing an error to `MDTRY()`
+// is undefined behavior. For example, `MDTRY(status_or)` dereferences a
+// `StatusOr` that holds no value. Use `MDTRY()` only where the argument can't
+// be an error unless there is a bug, and prefer `MDVERIFY()` otherwise.
+//
+//   Status Blend(absl::Span<const float> a, absl::Span<float> b) {
+//     constexpr MERROR_DOMAIN(merror::Default);
+//     for (size_t i = 0; i != a.size(); ++i) {
+//       MDVERIFY(i < b.size()).ErrorCode(INTERNAL) << "Span too short";
+//       b[i] += a[i];
+//     }
+//     return Status::OK;
+//   }
+//
+// `MERROR_DEBUG_VERIFY` defaults to 0 if `NDEBUG` is defined and to 1
+// otherwise. Like `assert()`, it must have the same value in all translation
+// units that share inline functions with these macros.
+#ifndef MERROR_DEBUG_VERIFY
+#ifdef NDEBUG
+#define MERROR_DEBUG_VERIFY 0
+#else
+#define MERROR_DEBUG_VERIFY 1
+#endif
+#endif
+
+#if MERROR_DEBUG_VERIFY
+#define MDVERIFY(...)                                            \
+  MERROR_INTERNAL_MVERIFY_IMPL(return, "MDVERIFY", #__VA_ARGS__, \
+                               (MErrorDomain()), __VA_ARGS__)
+
+#define MDTRY(...)                                                \
+  MERROR_INTERNAL_APPLY_VARIADIC(MERROR_INTERNAL_MTRY_, "MDTRY",  \
+                                 #__VA_ARGS__, (MErrorDomain()),  \
+                                 __VA_ARGS__)
+#else
+#define MDVERIFY(...)                                              \
+  switch (0)                                                       \
+  case 0:                                                          \
+  default:                                                         \
+    if constexpr (true) {                                          \
+    } else /* NOLINT */                                            \
+      MERROR_INTERNAL_MVERIFY_IMPL(return, "MDVERIFY", #__VA_ARGS__, \
+                                   (MErrorDomain()), __VA_ARGS__)
+
+#define MDTRY(...)                                                  \
+  MERROR_INTERNAL_APPLY_VARIADIC(MERROR_INTERNAL_MDTRY_, "MDTRY",   \
+                                 #__VA_ARGS__, (MErrorDomain()),    \
+                                 __VA_ARGS__)
+#endif
+
+// Coroutine versions of `MERROR()`, `MVERIFY()` and `MTRY()`. They have the
+// same syntax and use the same error domain as their non-coroutine
+// counterparts but leave the coroutine with `co_return` instead of `return`.
+// `MCO_ERROR()` creates an error and unconditionally `co_return`s it.
+//
+//   Task<StatusOr<string>> ReadFileAsync(StringPiece filepath);
+//
+//   Task<StatusOr<int>> CountLines(StringPiece filepath) {
+//     constexpr MERROR_DOMAIN(merror::Default);
+//     MCO_VERIFY(!filepath.empty()).ErrorCode(INVALID_ARGUMENT);
+//     StatusOr<string> read = co_await ReadFileAsync(filepath);
+//     string content = MCO_TRY(std::move(read));
+//     if (content.empty()) MCO_ERROR(NOT_FOUND) << "Empty file";
+//     co_return std::count(content.begin(), content.end(), '\n');
+//   }
+//
+// With `AutoReturn()` (the default) the error is converted to the parameter
+// type of `return_value()` of the coroutine's promise type, which is
+// `StatusOr<int>` in the example above. If `return_value()` is a template,
+// the type can't be deduced, and you need to specify it explicitly with
+// `Return<Type>()`.
+//
+// `MCO_TRY()` is implemented with a statement expression, just like `MTRY()`.
+// Some compilers can't handle `co_await` inside of a statement expression, so
+// await the result into a local variable first, as in the example above.
+//
+// These macros require C++20.
+#define MCO_ERROR(...)                                        \
+  co_return MERROR_INTERNAL_MERROR("MCO_ERROR", #__VA_ARGS__, \
+                                   (MErrorDomain()), __VA_ARGS__)
+
+#define MCO_VERIFY(...)                                               \
+  MERROR_INTERNAL_MVERIFY_IMPL(co_return, "MCO_VERIFY", #__VA_ARGS__, \
+                               (MErrorDomain()), __VA_ARGS__)
+
+#define MCO_TRY(...)                                                  \
+  MERROR_INTERNAL_APPLY_VARIADIC(MERROR_INTERNAL_MCO_TRY_, "MCO_TRY", \
+                                 #__VA_ARGS__, (MErrorDomain()),      \
+                                 __VA_ARGS__)
+
 ///////////////////////////////////////////////////////////////////////////////
 //                   IMPLEMENTATION DETAILS FOLLOW                           //
 //                    DO NOT USE FROM OTHER FILES                            //
@@ -362,16 +560,25 @@
 //   if (condition) MVERIFY(expr);
 //
 // The `switch (convertible-to-zero) case 0:` idiom is used to suppress this.
-#define MERROR_INTERNAL_MVERIFY_IMPL(MACRO, ARGS, DOMAIN, EXPR)                \
+//
+// The timer is started in the init-statement of `if`, so that it runs before
+// `EXPR` is evaluated.
+//
+// `RETURN` is either `return` or `co_return`.
+#define MERROR_INTERNAL_MVERIFY_IMPL(RETURN, MACRO, ARGS, DOMAIN, EXPR)        \
   switch (const auto _gverify_domain_ =                                        \
               ::merror::internal_macros::WrapDomain((DOMAIN)))                 \
   case 0:                                                                      \
   default:                                                                     \
-    if (auto _gverify_val_ = INTERNAL_MERROR_EXPAND_EXPR(                      \
-            ::merror::internal_macros::MakeVerifier(&_gverify_domain_.value),  \
+    if (auto _gverify_timer_ = ::merror::internal_macros::StartTimer(          \
+            _gverify_domain_.value, MERROR_INTERNAL_SITE(), 0);                \
+        auto _gverify_val_ = INTERNAL_MERROR_EXPAND_EXPR(                      \
+            ::merror::internal_macros::MakeVerifier(&_gverify_domain_.value,   \
+                                                    &_gverify_timer_,          \
+                                                    MERROR_INTERNAL_SITE()),   \
             EXPR)) {                                                           \
     } else /* NOLINT */                                                        \
-      return ::merror::MErrorAccess<                                           \
+      RETURN ::merror::MErrorAccess<                                           \
                  ::merror::internal_macros::ErrorBuilderFinalizer>() =         \
                  _gverify_domain_.value.GetErrorBuilder(                       \
                      ::merror::internal::MakeContext<                          \
@@ -381,6 +588,85 @@
                          ::std::move(*_gverify_val_.culprit),                  \
                          _gverify_val_.rel_expr.get()))
 
+// An object of type unique to the file and line of the macro. See
+// `ShouldShortCircuit()` in the comments at the top of the file.
+#define MERROR_INTERNAL_SITE()                                        \
+  ::merror::internal_macros::Site<                                    \
+      ::merror::internal_macros::FileHash(__FILE__), __LINE__>{__FILE__}
+
+// On the happy path `MVERIFY_ALL()` evaluates every condition and takes a
+// single branch. On failure `Explain()` finds the first false condition and
+// re-evaluates it in order to describe it. The comma operator sequences
+// `Explain()` before the construction of the error context.
+#define MERROR_INTERNAL_MVERIFY_ALL_IMPL(RETURN, MACRO, DOMAIN, ...)         \
+  switch (const auto _gverify_domain_ =                                      \
+              ::merror::internal_macros::WrapDomain((DOMAIN)))               \
+  case 0:                                                                    \
+  default:                                                                   \
+    if (auto _gverify_all_ = ::merror::internal_macros::VerifyAll(           \
+            {MERROR_INTERNAL_FOR_EACH(MERROR_INTERNAL_MVERIFY_ALL_COND,      \
+                                      __VA_ARGS__)});                        \
+        MERROR_PREDICT_TRUE(_gverify_all_.ok())) {                           \
+    } else /* NOLINT */                                                      \
+      RETURN _gverify_all_.Explain(                                          \
+          {MERROR_INTERNAL_FOR_EACH(MERROR_INTERNAL_MVERIFY_ALL_ARG,         \
+                                    __VA_ARGS__)} MERROR_INTERNAL_FOR_EACH(  \
+              MERROR_INTERNAL_MVERIFY_ALL_EXPLAINER, __VA_ARGS__)),          \
+          ::merror::MErrorAccess<                                            \
+              ::merror::internal_macros::ErrorBuilderFinalizer>() =          \
+              _gverify_domain_.value.GetErrorBuilder(                        \
+                  ::merror::internal::MakeContext<::merror::Macro::kVerify>( \
+                      ::merror::internal_macros::TypeId([] {}),              \
+                      __PRETTY_FUNCTION__, __FILE__, __LINE__, MACRO,        \
+                      _gverify_all_.args_str,                                \
+                      ::merror::internal_macros::FalseCulprit(               \
+                          _gverify_domain_.value),                           \
+                      _gverify_all_.rel_expr.get()))
+
+// `VerifyEach()` calls the second lambda only for the first failing element, in
+// order to describe it.
+#define MERROR_INTERNAL_MVERIFY_EACH_IMPL(RETURN, MACRO, ARGS, DOMAIN, RANGE, \
+                                          ...)                                \
+  switch (const auto _gverify_domain_ =                                       \
+              ::merror::internal_macros::WrapDomain((DOMAIN)))                \
+  case 0:                                                                     \
+  default:                                                                    \
+    if (auto _gverify_each_ = ::merror::internal_macros::VerifyEach(          \
+            RANGE,                                                            \
+            [&](const auto& _) {                                              \
+              return ::merror::internal_macros::VerifyAllCondition(           \
+                  __VA_ARGS__);                                               \
+            },                                                                \
+            [&](const auto& _) {                                              \
+              return INTERNAL_MERROR_EXPAND_EXPR(                             \
+                  ::merror::internal_macros::MakeExplainer(                   \
+                      &_gverify_domain_.value),                               \
+                  __VA_ARGS__);                                               \
+            });                                                               \
+        MERROR_PREDICT_TRUE(_gverify_each_.ok())) {                           \
+    } else /* NOLINT */                                                       \
+      RETURN ::merror::MErrorAccess<                                          \
+                 ::merror::internal_macros::ErrorBuilderFinalizer>() =        \
+                 _gverify_domain_.value.GetErrorBuilder(                      \
+                     ::merror::internal::MakeContext<                         \
+                         ::merror::Macro::kVerify>(                           \
+                         ::merror::internal_macros::TypeId([] {}),            \
+                         __PRETTY_FUNCTION__, __FILE__, __LINE__, MACRO,      \
+                         ARGS,                                                \
+                         ::merror::internal_macros::FalseCulprit(             \
+                             _gverify_domain_.value),                         \
+                         _gverify_each_.rel_expr.get(), _gverify_each_.index))
+
+#define MERROR_INTERNAL_MVERIFY_ALL_COND(EXPR) \
+  ::merror::internal_macros::VerifyAllCondition(EXPR),
+#define MERROR_INTERNAL_MVERIFY_ALL_ARG(EXPR) #EXPR,
+#define MERROR_INTERNAL_MVERIFY_ALL_EXPLAINER(EXPR)                        \
+  , [&] {                                                                  \
+    return INTERNAL_MERROR_EXPAND_EXPR(                                    \
+        ::merror::internal_macros::MakeExplainer(&_gverify_domain_.value), \
+        EXPR);                                                             \
+  }
+
 #define MERROR_INTERNAL_APPLY_VARIADIC(F, MACRO, ARGS, DOMAIN, ...) \
   MERROR_INTERNAL_VCAT(F, MERROR_INTERNAL_NARG(__VA_ARGS__))        \
   (MACRO, ARGS, DOMAIN, __VA_ARGS__)
@@ -508,7 +794,217 @@ struct IsValidVerifyArg<Domain, Arg,
                         typename VoidT<VerificationCulprit<Domain, Arg>>::type>
     : std::true_type {};
 
+// Calls `domain.ShouldInjectFault(site)` if the domain has it. See
+// //util/merror/domain/fault_injection.h.
+template <class Domain, class Site>
+MERROR_ATTRIBUTE_ALWAYS_INLINE inline auto ShouldInjectFault(
+    const Domain& domain, Site site, int)
+    -> decltype(static_cast<bool>(domain.ShouldInjectFault(site))) {
+  return domain.ShouldInjectFault(site);
+}
+
+template <class Domain, class Site>
+constexpr bool ShouldInjectFault(const Domain&, Site, unsigned) {
+  return false;
+}
+
+// Returns `domain.InjectedCulprit()` converted to `Culprit`, the type of the
+// regular culprit of `MVERIFY()`.
+template <class Culprit, class Domain>
+auto InjectedVerifyCulprit(const Domain& domain, int) ->
+    typename std::enable_if<
+        std::is_constructible<Culprit,
+                              decltype(domain.InjectedCulprit())>::value,
+        Culprit>::type {
+  return Culprit(domain.InjectedCulprit());
+}
+
+// Empty tags carry no information, so any value will do.
+template <class Culprit, class Domain>
+auto InjectedVerifyCulprit(const Domain& domain, unsigned) ->
+    typename std::enable_if<(std::is_empty<Culprit>::value &&
+                             std::is_default_constructible<Culprit>::value) ||
+                                std::is_null_pointer<Culprit>::value,
+                            decltype((void)domain.InjectedCulprit(),
+                                     Culprit())>::type {
+  return Culprit();
+}
+
+// Calls `domain.ShouldInjectFault(site)` if the domain has it and `MVERIFY()`
+// can make a culprit of type `Culprit` for the fault. Sets `culprit` and
+// returns true if the fault is injected.
+template <class Culprit, class Domain, class Site>
+MERROR_ATTRIBUTE_ALWAYS_INLINE inline auto InjectVerifyFault(
+    const Domain& domain, Site site, Optional<Culprit>& culprit, int)
+    -> decltype((void)InjectedVerifyCulprit<Culprit>(domain, 0),
+                static_cast<bool>(domain.ShouldInjectFault(site))) {
+  if (MERROR_PREDICT_TRUE(!domain.ShouldInjectFault(site))) return false;
+  culprit.emplace(InjectedVerifyCulprit<Culprit>(domain, 0));
+  return true;
+}
+
+template <class Culprit, class Domain, class Site>
+constexpr bool InjectVerifyFault(const Domain&, Site, Optional<Culprit>&,
+                                 unsigned) {
+  return false;
+}
+
+// Set by `MTRY()` when a fault has been injected. Cleared by
+// `TakeInjectedFault()` in the error branch of the same `MTRY()`.
+inline thread_local bool fault_injected = false;
+
+// Returns true if the last `MTRY()` has injected a fault.
+template <class Domain, class Site>
+inline auto TakeInjectedFault(const Domain& domain, Site site, int)
+    -> decltype(static_cast<bool>(domain.ShouldInjectFault(site))) {
+  bool res = fault_injected;
+  fault_injected = false;
+  return res;
+}
+
+template <class Domain, class Site>
+constexpr bool TakeInjectedFault(const Domain&, Site, unsigned) {
+  return false;
+}
+
+// Returns `domain.InjectedCulprit()` if the domain has it. Otherwise
+// `TakeInjectedFault()` always returns false, and this function is never
+// called. It then returns `Culprit`, the type of the regular culprit, in order
+// to instantiate the same error builder.
+template <class Culprit, class Domain>
+auto InjectedCulprit(const Domain& domain, int)
+    -> decltype(domain.InjectedCulprit()) {
+  return domain.InjectedCulprit();
+}
+
+template <class Culprit, class Domain>
+Culprit InjectedCulprit(const Domain&, unsigned) {
+  abort();
+}
+
+// FNV-1a hash of a null-terminated string.
+constexpr uint64_t FileHash(const char* s) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (; *s; ++s) h = (h ^ static_cast<unsigned char>(*s)) * 0x100000001b3ull;
+  return h;
+}
+
+// Identifies the location of `MTRY()` or `MVERIFY()`. The type is unique to
+// the file and line. See `ShouldShortCircuit()` in the comments at the top of
+// the file.
+template <uint64_t kFileHash, int kLine>
+struct Site {
+  static constexpr int line = kLine;
+  const char* file;
+};
+
+// Set by `ShouldShortCircuit()` when it returns true. Cleared by
+// `TakeShortCircuit()` in the error branch of the same `MTRY()`.
+inline thread_local bool short_circuited = false;
+
+// Calls `domain.ShouldShortCircuit(site)` if the domain has it. See
+// //util/merror/domain/circuit_breaker.h.
+template <class Domain, class Site>
+MERROR_ATTRIBUTE_ALWAYS_INLINE inline auto ShouldShortCircuit(
+    const Domain& domain, Site site, int)
+    -> decltype(static_cast<bool>(domain.ShouldShortCircuit(site))) {
+  if (MERROR_PREDICT_TRUE(!domain.ShouldShortCircuit(site))) return false;
+  short_circuited = true;
+  return true;
+}
+
+template <class Domain, class Site>
+constexpr bool ShouldShortCircuit(const Domain&, Site, unsigned) {
+  return false;
+}
+
+// Returns true if the last call to `ShouldShortCircuit()` has returned true.
+template <class Domain, class Site>
+inline auto TakeShortCircuit(const Domain& domain, Site site, int)
+    -> decltype(static_cast<bool>(domain.ShouldShortCircuit(site))) {
+  bool res = short_circuited;
+  short_circuited = false;
+  return res;
+}
+
+template <class Domain, class Site>
+constexpr bool TakeShortCircuit(const Domain&, Site, unsigned) {
+  return false;
+}
+
+// Returns `domain.ShortCircuitCulprit(site)` if the domain has it. Otherwise
+// `TakeShortCircuit()` always returns false, and this function is never called.
+// It then returns `Culprit`, the type of the regular culprit, in order to
+// instantiate the same error builder.
+template <class Culprit, class Domain, class Site>
+auto ShortCircuitCulprit(const Domain& domain, Site site, int)
+    -> decltype(domain.ShortCircuitCulprit(site)) {
+  return domain.ShortCircuitCulprit(site);
+}
+
+template <class Culprit, class Domain, class Site>
+Culprit ShortCircuitCulprit(const Domain&, Site, unsigned) {
+  abort();
+}
+
+// Returned by `StartTimer()` for domains without the method.
+struct NoTimer {
+  void Stop(bool) {}
+};
+
+// Calls `domain.StartTimer(site)` if the domain has it. See
+// //util/merror/domain/timed.h.
+template <class Domain, class Site>
+MERROR_ATTRIBUTE_ALWAYS_INLINE inline auto StartTimer(const Domain& domain,
+                                                      Site site, int)
+    -> decltype(domain.StartTimer(site)) {
+  return domain.StartTimer(site);
+}
+
+template <class Domain, class Site>
+NoTimer StartTimer(const Domain&, Site, unsigned) {
+  return {};
+}
+
+// Calls `domain.ObserveOutcome(site, error)` if the domain has it.
+template <class Domain, class Site>
+MERROR_ATTRIBUTE_ALWAYS_INLINE inline auto ObserveOutcome(const Domain& domain,
+                                                          Site site, bool error,
+                                                          int)
+    -> decltype(domain.ObserveOutcome(site, error)) {
+  domain.ObserveOutcome(site, error);
+}
+
+template <class Domain, class Site>
+void ObserveOutcome(const Domain&, Site, bool, unsigned) {}
+
+// Returns `Domain::ExpectsErrors()` if the domain has it. See
+// //util/merror/domain/expect_errors.h.
 template <class Domain>
+constexpr auto ExpectsErrors(int) -> decltype(static_cast<bool>(
+    std::decay<Domain>::type::ExpectsErrors())) {
+  return std::decay<Domain>::type::ExpectsErrors();
+}
+
+template <class Domain>
+constexpr bool ExpectsErrors(unsigned) {
+  return false;
+}
+
+// Hints that `x`, which is true on error, is likely false. If `Domain` expects
+// errors, neither outcome is favored instead.
+#if MERROR_HAVE_BUILTIN(__builtin_expect_with_probability)
+#define MERROR_INTERNAL_PREDICT_EVEN(x) \
+  (__builtin_expect_with_probability(false || (x), true, 0.5))
+#else
+#define MERROR_INTERNAL_PREDICT_EVEN(x) (x)
+#endif
+#define MERROR_INTERNAL_PREDICT_ERROR(Domain, x)          \
+  (::merror::internal_macros::ExpectsErrors<Domain>(0)    \
+       ? MERROR_INTERNAL_PREDICT_EVEN(x)                  \
+       : MERROR_PREDICT_FALSE(x))
+
+template <class Domain, class Timer, class Site>
 struct Verifier {
   // This overload is called when the argument of `MVERIFY()` is a relational
   // expression.
@@ -521,9 +1017,9 @@ struct Verifier {
     auto&& acceptor =
         domain.Verify(internal_macros::MakeRef(std::forward<Expr>(expr)));
     VerificationResult<typename std::decay<Culprit>::type> res;
-    if (MERROR_PREDICT_FALSE(acceptor.IsError())) {
-      res.culprit.emplace(
-          std::forward<decltype(acceptor)>(acceptor).GetCulprit());
+    if (MERROR_INTERNAL_PREDICT_ERROR(
+            Domain, Check(std::forward<decltype(acceptor)>(acceptor),
+                          res.culprit))) {
       res.rel_expr.emplace();
       if (domain.PrintOperands(left, right, &res.rel_expr->left,
                                &res.rel_expr->right)) {
@@ -545,10 +1041,7 @@ struct Verifier {
     auto&& acceptor =
         domain.Verify(internal_macros::MakeRef(std::forward<Expr>(expr)));
     VerificationResult<typename std::decay<Culprit>::type> res;
-    if (MERROR_PREDICT_FALSE(acceptor.IsError())) {
-      res.culprit.emplace(
-          std::forward<decltype(acceptor)>(acceptor).GetCulprit());
-    }
+    Check(std::forward<decltype(acceptor)>(acceptor), res.culprit);
     return res;
   }
 
@@ -575,9 +1068,187 @@ struct Verifier {
     return {};
   }
 
+  // Sets `culprit` and returns true on error. The culprit of an injected fault
+  // doesn't come from the acceptor, which has reported success.
+  template <class Acceptor, class Culprit>
+  bool Check(Acceptor&& acceptor, Optional<Culprit>& culprit) const {
+    if (MERROR_INTERNAL_PREDICT_ERROR(Domain, acceptor.IsError())) {
+      timer->Stop(true);
+      culprit.emplace(std::forward<Acceptor>(acceptor).GetCulprit());
+      return true;
+    }
+    bool injected = InjectVerifyFault(domain, site, culprit, 0);
+    timer->Stop(injected);
+    return injected;
+  }
+
+  const Domain& domain;
+  // Started before the argument of `MVERIFY()` is evaluated.
+  Timer* timer;
+  // The location of `MVERIFY()`.
+  Site site;
+};
+
+// Describes a relational expression the same way `Verifier` does. Used by
+// `MVERIFY_ALL()` to explain the condition that has failed.
+template <class Domain>
+struct Explainer {
+  template <class L, class Op, class R, class Expr>
+  Optional<RelationalExpression> operator()(const L& left, Op op,
+                                            const R& right, Expr&&) const {
+    Optional<RelationalExpression> res;
+    res.emplace();
+    if (domain.PrintOperands(left, right, &res->left, &res->right)) {
+      res->op = op;
+    } else {
+      res.clear();
+    }
+    return res;
+  }
+
+  template <class Expr>
+  Optional<RelationalExpression> operator()(Expr&&) const {
+    return {};
+  }
+
   const Domain& domain;
 };
 
+template <class Domain>
+Explainer<Domain> MakeExplainer(const Domain* domain) {
+  return {*domain};
+}
+
+// `MVERIFY_ALL()` and `MVERIFY_EACH()` accept only `bool` conditions, just like
+// `AcceptBool()`.
+inline bool VerifyAllCondition(bool cond) { return cond; }
+
+template <class T>
+bool VerifyAllCondition(const T&) {
+  static_assert(sizeof(T) == 0,
+                "MVERIFY_ALL() and MVERIFY_EACH() conditions must be bool");
+  return false;
+}
+
+// The culprit of a failed `MVERIFY_ALL()` or `MVERIFY_EACH()` is the one that
+// `MVERIFY(false)` would have.
+template <class Domain,
+          class Culprit = typename std::decay<
+              VerificationCulprit<Domain, bool>>::type>
+Culprit FalseCulprit(const Domain& domain) {
+  return domain.Verify(internal_macros::MakeRef(false)).GetCulprit();
+}
+
+struct VerifyAllResult {
+  explicit VerifyAllResult(uint64_t failed) : failed(failed) {}
+
+  bool ok() const { return failed == 0; }
+
+  // Finds the first false condition and describes it. `args` are the
+  // stringized conditions; `explainers` re-evaluate them.
+  template <class... Explainers>
+  void Explain(std::initializer_list<const char*> args,
+               Explainers&&... explainers) {
+    static_assert(sizeof...(Explainers) <= 32,
+                  "MVERIFY_ALL() supports at most 32 conditions");
+    int index = 0;
+    while (!(failed >> index & 1)) ++index;
+    args_str = args.begin()[index];
+    int i = 0;
+    // Only the explainer of the failed condition is called.
+    (void)std::initializer_list<int>{
+        (i++ == index ? ExplainOne(std::forward<Explainers>(explainers))
+                      : void(),
+         0)...};
+  }
+
+  template <class F>
+  void ExplainOne(F&& f) {
+    Optional<RelationalExpression> res = std::forward<F>(f)();
+    if (res) rel_expr.emplace(std::move(*res));
+  }
+
+  // Bit `i` is set if and only if condition `i` is false.
+  uint64_t failed;
+  const char* args_str = nullptr;
+  Optional<RelationalExpression> rel_expr;
+};
+
+template <size_t N, size_t... I>
+MERROR_ATTRIBUTE_ALWAYS_INLINE inline uint64_t FailedMask(
+    const bool (&conds)[N], std::index_sequence<I...>) {
+  return (0 | ... | (static_cast<uint64_t>(!conds[I]) << I));
+}
+
+// Combines the conditions into a bitmask without branching.
+template <size_t N>
+MERROR_ATTRIBUTE_ALWAYS_INLINE inline VerifyAllResult VerifyAll(
+    const bool (&conds)[N]) {
+  static_assert(N <= 32, "MVERIFY_ALL() supports at most 32 conditions");
+  return VerifyAllResult(FailedMask(conds, std::make_index_sequence<N>()));
+}
+
+struct VerifyEachResult {
+  bool ok() const { return index < 0; }
+
+  template <class Elem, class Explain>
+  void Fail(std::ptrdiff_t i, const Elem& elem, Explain& explain) {
+    index = i;
+    Optional<RelationalExpression> res = explain(elem);
+    if (res) rel_expr.emplace(std::move(*res));
+  }
+
+  // Index of the first element that doesn't satisfy the predicate, or -1.
+  std::ptrdiff_t index = -1;
+  Optional<RelationalExpression> rel_expr;
+};
+
+// The number of elements that `VerifyEach()` checks without branching.
+constexpr std::ptrdiff_t kVerifyEachBlock = 16;
+
+// Checks `pred` against every element of `range`. If some element fails,
+// `explain` is called for the first one.
+template <class Range, class Pred, class Explain>
+MERROR_ATTRIBUTE_ALWAYS_INLINE inline VerifyEachResult VerifyEach(
+    Range&& range, Pred pred, Explain explain) {
+  using std::begin;
+  using std::end;
+  auto first = begin(range);
+  auto last = end(range);
+  VerifyEachResult res;
+  using Category =
+      typename std::iterator_traits<decltype(first)>::iterator_category;
+  if constexpr (std::is_base_of<std::random_access_iterator_tag,
+                                Category>::value) {
+    const std::ptrdiff_t n = last - first;
+    std::ptrdiff_t i = 0;
+    for (; i + kVerifyEachBlock <= n; i += kVerifyEachBlock) {
+      // GCC vectorizes this form of reduction at -O2 but not `ok &= pred()`.
+      unsigned failed = 0;
+      for (std::ptrdiff_t j = 0; j != kVerifyEachBlock; ++j) {
+        failed |= !pred(first[i + j]);
+      }
+      if (MERROR_PREDICT_FALSE(failed)) break;
+    }
+    // Scans the failed block or the tail that doesn't fill a block.
+    for (; i != n; ++i) {
+      if (MERROR_PREDICT_FALSE(!pred(first[i]))) {
+        res.Fail(i, first[i], explain);
+        break;
+      }
+    }
+  } else {
+    std::ptrdiff_t i = 0;
+    for (; first != last; ++first, ++i) {
+      if (MERROR_PREDICT_FALSE(!pred(*first))) {
+        res.Fail(i, *first, explain);
+        break;
+      }
+    }
+  }
+  return res;
+}
+
 struct ErrorBuilderFinalizer {};
 
 template <class T>
@@ -597,9 +1268,10 @@ Expr<U> operator,(U&& expr, Expr<T>) {
   return {std::forward<U>(expr)};
 }
 
-template <class Domain>
-Verifier<Domain> MakeVerifier(const Domain* domain) {
-  return {*domain};
+template <class Domain, class Timer, class Site>
+Verifier<Domain, Timer, Site> MakeVerifier(const Domain* domain, Timer* timer,
+                                           Site site) {
+  return {*domain, timer, site};
 }
 
 // The macros pass a lambda as an argument:
@@ -607,11 +1279,11 @@ Verifier<Domain> MakeVerifier(const Domain* domain) {
 //   TypeId([] {})
 //
 // Since lambdas have unique types, this gives us unique integers for macro
-// expansions.
+// expansions. The integer is the address of the state of the expansion.
 template <class T>
 uintptr_t TypeId(const T&) {
-  static constexpr char c = 0;
-  return reinterpret_cast<uintptr_t>(&c);
+  static internal::SiteState state;
+  return reinterpret_cast<uintptr_t>(&state);
 }
 
 }  // namespace internal_macros
@@ -670,9 +1342,14 @@ struct MErrorAccess<internal_macros::ErrorBuilderFinalizer> {
 //   // The type of the expression is `int*`. `static_assert` doesn't trigger.
 //   MTRY([]() -> int* { return nullptr; }());
 //
-#define MERROR_INTERNAL_MTRY_IMPL(MACRO, ARGS, KEY, DOMAIN, EXPR,              \
+// `RETURN` is either `return` or `co_return`.
+#define MERROR_INTERNAL_MTRY_IMPL(RETURN, MACRO, ARGS, KEY, DOMAIN, EXPR,      \
                                   BUILDER_PATCH)                               \
-  (MERROR_INTERNAL_MTRY_STATE(DOMAIN, EXPR, KEY).GetSelfOrNull() ?: ({         \
+  ((MERROR_PREDICT_FALSE(::merror::internal_macros::ShouldShortCircuit(        \
+        (DOMAIN), MERROR_INTERNAL_SITE(), 0))                                  \
+        ? nullptr                                                              \
+        : MERROR_INTERNAL_MTRY_STATE(DOMAIN, EXPR, KEY)                        \
+              .GetSelfOrNull(MERROR_INTERNAL_SITE())) ?: ({                    \
     constexpr auto _gtry_state1_ =                                             \
         true ? nullptr                                                         \
              : ::merror::internal_macros::Ptr(                                 \
@@ -686,10 +1363,38 @@ struct MErrorAccess<internal_macros::ErrorBuilderFinalizer> {
                        decltype(_gtry_state2_)>::value,                        \
         "Sorry. MTRY() can't be called with this argument, since the "         \
         "argument results in different types when evaluated more than once."); \
-    auto* _gtry_stash_ = ::merror::internal::tls_map::Get<                     \
-        typename std::remove_pointer<decltype(_gtry_state1_)>::type::Stash>(   \
-        KEY);                                                                  \
-    return ::merror::MErrorAccess<                                             \
+    using _gtry_stash_type_ =                                                  \
+        typename std::remove_pointer<decltype(_gtry_state1_)>::type::Stash;    \
+    if (MERROR_PREDICT_FALSE(::merror::internal_macros::TakeShortCircuit(      \
+            (DOMAIN), MERROR_INTERNAL_SITE(), 0))) {                           \
+      RETURN ::merror::MErrorAccess<                                           \
+                 ::merror::internal_macros::ErrorBuilderFinalizer>() =         \
+                 ::merror::internal_macros::Const((DOMAIN)).GetErrorBuilder(   \
+                     ::merror::internal::MakeContext<::merror::Macro::kTry>(   \
+                         ::merror::internal_macros::TypeId([] {}),             \
+                         __PRETTY_FUNCTION__, __FILE__, __LINE__, MACRO, ARGS, \
+                         ::merror::internal_macros::ShortCircuitCulprit<       \
+                             decltype(::std::declval<_gtry_stash_type_&>()     \
+                                          .GetCulprit())>(                     \
+                             (DOMAIN), MERROR_INTERNAL_SITE(), 0),             \
+                         nullptr)) BUILDER_PATCH;                              \
+    }                                                                          \
+    if (MERROR_PREDICT_FALSE(::merror::internal_macros::TakeInjectedFault(     \
+            (DOMAIN), MERROR_INTERNAL_SITE(), 0))) {                           \
+      RETURN ::merror::MErrorAccess<                                           \
+                 ::merror::internal_macros::ErrorBuilderFinalizer>() =         \
+                 ::merror::internal_macros::Const((DOMAIN)).GetErrorBuilder(   \
+                     ::merror::internal::MakeContext<::merror::Macro::kTry>(   \
+                         ::merror::internal_macros::TypeId([] {}),             \
+                         __PRETTY_FUNCTION__, __FILE__, __LINE__, MACRO, ARGS, \
+                         ::merror::internal_macros::InjectedCulprit<           \
+                             decltype(::std::declval<_gtry_stash_type_&>()     \
+                                          .GetCulprit())>((DOMAIN), 0),        \
+                         nullptr)) BUILDER_PATCH;                              \
+    }                                                                          \
+    auto* _gtry_stash_ =                                                       \
+        ::merror::internal::tls_map::Get<_gtry_stash_type_>(KEY);              \
+    RETURN ::merror::MErrorAccess<                                             \
                ::merror::internal_macros::ErrorBuilderFinalizer>() =           \
                _gtry_stash_->GetDomain().GetErrorBuilder(                      \
                    ::merror::internal::MakeContext<::merror::Macro::kTry>(     \
@@ -700,9 +1405,9 @@ struct MErrorAccess<internal_macros::ErrorBuilderFinalizer> {
   }))->GetValue()
 
 #define MERROR_INTERNAL_MTRY_1(MACRO, ARGS, DOMAIN, EXPR) \
-  MERROR_INTERNAL_MTRY_IMPL(MACRO, ARGS, __COUNTER__, DOMAIN, EXPR, )
-#define MERROR_INTERNAL_MTRY_2(MACRO, ARGS, DOMAIN, EXPR, builder_patch) \
-  MERROR_INTERNAL_MTRY_IMPL(MACRO, ARGS, __COUNTER__, DOMAIN, EXPR,      \
+  MERROR_INTERNAL_MTRY_IMPL(return, MACRO, ARGS, __COUNTER__, DOMAIN, EXPR, )
+#define MERROR_INTERNAL_MTRY_2(MACRO, ARGS, DOMAIN, EXPR, builder_patch)    \
+  MERROR_INTERNAL_MTRY_IMPL(return, MACRO, ARGS, __COUNTER__, DOMAIN, EXPR, \
                             MERROR_INTERNAL_HANDLE_UNDERSCORE(builder_patch))
 #define MERROR_INTERNAL_MTRY_3(MACRO, ARGS, DOMAIN, A1, A2, A3) \
   _Pragma("GCC error \"MTRY() can't be called with 3 arguments\"")
@@ -713,19 +1418,68 @@ struct MErrorAccess<internal_macros::ErrorBuilderFinalizer> {
 #define MERROR_INTERNAL_MTRY_6(MACRO, ARGS, DOMAIN, A1, A2, A3, A4, A5, A6) \
   _Pragma("GCC error \"MTRY() can't be called with 6 arguments\"")
 
-// If `decltype(EXPR)` is `void`, the second argument of `MakeMTryState()` is
+// `MDTRY()` with `MERROR_DEBUG_VERIFY` set to 0. The regular `MTRY()` is
+// compiled in a discarded branch, like in `MDVERIFY()`, so that the builder
+// patch keeps compiling. See the warning at `MDTRY()`.
+#define MERROR_INTERNAL_MDTRY_IMPL(MACRO, ARGS, DOMAIN, EXPR, BUILDER_PATCH)  \
+  (({                                                                         \
+     if constexpr (false) {                                                   \
+       static_cast<void>(MERROR_INTERNAL_MTRY_IMPL(                           \
+           return, MACRO, ARGS, __COUNTER__, DOMAIN, EXPR, BUILDER_PATCH));   \
+     }                                                                        \
+   }),                                                                        \
+   ::merror::internal_macros::MakeUncheckedTry(                               \
+       (DOMAIN),                                                              \
+       ((EXPR),                                                               \
+        ::merror::internal_macros::Expr<::merror::Void>{::merror::Void()})    \
+           .get()))                                                           \
+      .GetValue()
+#define MERROR_INTERNAL_MDTRY_1(MACRO, ARGS, DOMAIN, EXPR) \
+  MERROR_INTERNAL_MDTRY_IMPL(MACRO, ARGS, DOMAIN, EXPR, )
+#define MERROR_INTERNAL_MDTRY_2(MACRO, ARGS, DOMAIN, EXPR, builder_patch) \
+  MERROR_INTERNAL_MDTRY_IMPL(MACRO, ARGS, DOMAIN, EXPR,                   \
+                             MERROR_INTERNAL_HANDLE_UNDERSCORE(builder_patch))
+#define MERROR_INTERNAL_MDTRY_3(MACRO, ARGS, DOMAIN, A1, A2, A3) \
+  _Pragma("GCC error \"MDTRY() can't be called with 3 arguments\"")
+#define MERROR_INTERNAL_MDTRY_4(MACRO, ARGS, DOMAIN, A1, A2, A3, A4) \
+  _Pragma("GCC error \"MDTRY() can't be called with 4 arguments\"")
+#define MERROR_INTERNAL_MDTRY_5(MACRO, ARGS, DOMAIN, A1, A2, A3, A4, A5) \
+  _Pragma("GCC error \"MDTRY() can't be called with 5 arguments\"")
+#define MERROR_INTERNAL_MDTRY_6(MACRO, ARGS, DOMAIN, A1, A2, A3, A4, A5, A6) \
+  _Pragma("GCC error \"MDTRY() can't be called with 6 arguments\"")
+
+#define MERROR_INTERNAL_MCO_TRY_1(MACRO, ARGS, DOMAIN, EXPR)                   \
+  MERROR_INTERNAL_MTRY_IMPL(co_return, MACRO, ARGS, __COUNTER__, DOMAIN, EXPR, \
+                            )
+#define MERROR_INTERNAL_MCO_TRY_2(MACRO, ARGS, DOMAIN, EXPR, builder_patch)    \
+  MERROR_INTERNAL_MTRY_IMPL(co_return, MACRO, ARGS, __COUNTER__, DOMAIN, EXPR, \
+                            MERROR_INTERNAL_HANDLE_UNDERSCORE(builder_patch))
+#define MERROR_INTERNAL_MCO_TRY_3(MACRO, ARGS, DOMAIN, A1, A2, A3) \
+  _Pragma("GCC error \"MCO_TRY() can't be called with 3 arguments\"")
+#define MERROR_INTERNAL_MCO_TRY_4(MACRO, ARGS, DOMAIN, A1, A2, A3, A4) \
+  _Pragma("GCC error \"MCO_TRY() can't be called with 4 arguments\"")
+#define MERROR_INTERNAL_MCO_TRY_5(MACRO, ARGS, DOMAIN, A1, A2, A3, A4, A5) \
+  _Pragma("GCC error \"MCO_TRY() can't be called with 5 arguments\"")
+#define MERROR_INTERNAL_MCO_TRY_6(MACRO, ARGS, DOMAIN, A1, A2, A3, A4, A5, A6) \
+  _Pragma("GCC error \"MCO_TRY() can't be called with 6 arguments\"")
+
+// If `decltype(EXPR)` is `void`, the argument of `MakeState()` is
 // `merror::Void()`. Otherwise it's `EXPR`.
-#define MERROR_INTERNAL_MTRY_STATE(DOMAIN, EXPR, KEY)                     \
-  ::merror::internal_macros::MakeMTryState<KEY>(                          \
-      (DOMAIN),                                                           \
-      ((EXPR),                                                            \
-       ::merror::internal_macros::Expr<::merror::Void>{::merror::Void()}) \
-          .get())
+//
+// The object expression of a member function call is sequenced before its
+// arguments, so the timer is started before `EXPR` is evaluated.
+#define MERROR_INTERNAL_MTRY_STATE(DOMAIN, EXPR, KEY)                       \
+  ::merror::internal_macros::MakeMTryTimer<KEY>((DOMAIN),                   \
+                                                MERROR_INTERNAL_SITE())     \
+      .MakeState(                                                           \
+          ((EXPR),                                                          \
+           ::merror::internal_macros::Expr<::merror::Void>{::merror::Void()}) \
+              .get())
 
 namespace merror {
 namespace internal_macros {
 
-template <int Key, class Domain, class Expr>
+template <int Key, class Domain, class Expr, class Timer>
 class MTryState {
   using Acceptor =
       decltype(std::declval<const Domain&>().Try(std::declval<Ref<Expr&&>>()));
@@ -753,10 +1507,11 @@ class MTryState {
 
   // Implementation note: assume that the acceptor doesn't alias any temporaries
   // that might be created (and destroyed) during the call to `Try()`.
-  MTryState(Domain&& domain, Expr&& expr)
+  MTryState(Domain&& domain, Timer&& timer, Expr&& expr)
       : domain_(std::forward<Domain>(domain)),
         acceptor_(Const(domain_).Try(
             internal_macros::MakeRef(std::forward<Expr>(expr)))),
+        timer_(std::move(timer)),
         stash_(nullptr) {}
 
   // Non-copyable and non-movable.
@@ -768,13 +1523,26 @@ class MTryState {
       ::merror::internal::tls_map::Remove<Stash>(Key);
   }
 
-  MTryState* GetSelfOrNull() {
-    if (MERROR_PREDICT_FALSE(acceptor_.IsError())) {
+  template <class Site>
+  MTryState* GetSelfOrNull(Site site) {
+    bool error = MERROR_INTERNAL_PREDICT_ERROR(Domain, acceptor_.IsError());
+    // The acceptor of an injected fault isn't stashed: it has reported success
+    // and has no culprit. See `TakeInjectedFault()`.
+    bool injected =
+        !error && MERROR_PREDICT_FALSE(
+                      ShouldInjectFault(domain_, site, 0));
+    timer_.Stop(error || injected);
+    ObserveOutcome(domain_, site, error || injected, 0);
+    if (MERROR_INTERNAL_PREDICT_ERROR(Domain, error)) {
       stash_ = ::merror::internal::tls_map::Put<Stash>(
           Key, std::forward<Domain>(domain_),
           std::forward<Acceptor>(acceptor_));
       return nullptr;
     }
+    if (MERROR_PREDICT_FALSE(injected)) {
+      fault_injected = true;
+      return nullptr;
+    }
     return this;
   }
 
@@ -786,14 +1554,60 @@ class MTryState {
   static_assert(!std::is_rvalue_reference<Domain>(), "");
   Domain&& domain_;
   Acceptor acceptor_;
+  Timer timer_;
   Stash* stash_;
 };
 
-template <int Key, class Domain, class Expr>
-MTryState<Key, Domain, Expr> MakeMTryState(Domain&& domain, Expr&& expr) {
+// The argument of `MDTRY()` with `MERROR_DEBUG_VERIFY` set to 0. Extracts the
+// value without checking for errors, which is undefined behavior for most
+// acceptors if the argument is an error. Lives until the end of the full
+// expression, like `MTryState`, so that the value may refer to the acceptor.
+template <class Domain, class Expr>
+class UncheckedTry {
+  using Acceptor =
+      decltype(std::declval<const Domain&>().Try(std::declval<Ref<Expr&&>>()));
+
+ public:
+  UncheckedTry(Domain&& domain, Expr&& expr)
+      : acceptor_(Const(domain).Try(
+            internal_macros::MakeRef(std::forward<Expr>(expr)))) {}
+
+  UncheckedTry(const UncheckedTry&) = delete;
+  UncheckedTry& operator=(const UncheckedTry&) = delete;
+
+  decltype(std::declval<Acceptor>().GetValue()) GetValue() {
+    return std::forward<Acceptor>(acceptor_).GetValue();
+  }
+
+ private:
+  Acceptor acceptor_;
+};
+
+template <class Domain, class Expr>
+UncheckedTry<Domain, Expr> MakeUncheckedTry(Domain&& domain, Expr&& expr) {
   return {std::forward<Domain>(domain), std::forward<Expr>(expr)};
 }
 
+// Holds the timer started before the argument of `MTRY()` is evaluated.
+template <int Key, class Domain, class Timer>
+struct MTryTimer {
+  template <class Expr>
+  MTryState<Key, Domain, Expr, Timer> MakeState(Expr&& expr) && {
+    return {std::forward<Domain>(domain), std::move(timer),
+            std::forward<Expr>(expr)};
+  }
+
+  Domain&& domain;
+  Timer timer;
+};
+
+template <int Key, class Domain, class Site>
+MTryTimer<Key, Domain, decltype(StartTimer(std::declval<const Domain&>(),
+                                           std::declval<Site>(), 0))>
+MakeMTryTimer(Domain&& domain, Site site) {
+  return {std::forward<Domain>(domain), StartTimer(Const(domain), site, 0)};
+}
+
 }  // namespace internal_macros
 }  // namespace merror
 
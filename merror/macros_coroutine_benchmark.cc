@@ -0,0 +1,89 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Compares MCO_VERIFY and MCO_TRY against hand-written `co_return` on both the
+// success and the failure paths. Requires C++20.
+
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+#include "merror/internal/coroutine_task.h"
+#include "merror/internal/perf_counters.h"
+#include "merror/merror.h"
+
+namespace merror {
+namespace {
+
+using ::absl::Status;
+using ::absl::StatusCode;
+using ::absl::StatusOr;
+using ::merror::internal::Task;
+
+constexpr auto MErrorDomain =
+    merror::Default().DefaultErrorCode(StatusCode::kUnknown);
+
+Task<StatusOr<int>> HandVerify(int n) {
+  if (n < 0) co_return Status(StatusCode::kInvalidArgument, "n < 0");
+  co_return n;
+}
+
+Task<StatusOr<int>> MacroVerify(int n) {
+  MCO_VERIFY(n >= 0).ErrorCode(StatusCode::kInvalidArgument);
+  co_return n;
+}
+
+Task<StatusOr<int>> HandTry(StatusOr<int> x) {
+  if (!x.ok()) co_return x.status();
+  co_return *x + 1;
+}
+
+Task<StatusOr<int>> MacroTry(StatusOr<int> x) {
+  int n = MCO_TRY(std::move(x));
+  co_return n + 1;
+}
+
+template <Task<StatusOr<int>> (*F)(int)>
+void BM_Verify(benchmark::State& state) {
+  int n = state.range(0);
+  internal::PerfCounters perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(n);
+    benchmark::DoNotOptimize(F(n).Get());
+  }
+  perf.Report(state);
+}
+
+template <Task<StatusOr<int>> (*F)(StatusOr<int>)>
+void BM_Try(benchmark::State& state) {
+  StatusOr<int> x = state.range(0) >= 0
+                        ? StatusOr<int>(state.range(0))
+                        : StatusOr<int>(Status(StatusCode::kNotFound, "x"));
+  internal::PerfCounters perf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(x);
+    benchmark::DoNotOptimize(F(x).Get());
+  }
+  perf.Report(state);
+}
+
+// Argument 1 takes the success path, -1 the failure path.
+BENCHMARK_TEMPLATE(BM_Verify, HandVerify)->Arg(1)->Arg(-1);
+BENCHMARK_TEMPLATE(BM_Verify, MacroVerify)->Arg(1)->Arg(-1);
+BENCHMARK_TEMPLATE(BM_Try, HandTry)->Arg(1)->Arg(-1);
+BENCHMARK_TEMPLATE(BM_Try, MacroTry)->Arg(1)->Arg(-1);
+
+}  // namespace
+}  // namespace merror
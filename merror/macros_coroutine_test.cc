@@ -0,0 +1,165 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Tests for MCO_ERROR, MCO_VERIFY and MCO_TRY. Requires C++20.
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/internal/coroutine_task.h"
+#include "merror/merror.h"
+
+namespace merror {
+namespace {
+
+using ::absl::Status;
+using ::absl::StatusCode;
+using ::absl::StatusOr;
+using ::merror::internal::Task;
+using ::testing::HasSubstr;
+
+constexpr auto MErrorDomain =
+    merror::Default().DefaultErrorCode(StatusCode::kUnknown);
+
+// Same as `Task` but with a templated `return_value()`. `AutoReturn()` can't
+// deduce the return type for such coroutines.
+template <class T>
+class GenericTask {
+ public:
+  struct promise_type {
+    std::optional<T> value;
+
+    GenericTask get_return_object() {
+      return GenericTask(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    template <class U>
+    void return_value(U&& v) {
+      value.emplace(std::forward<U>(v));
+    }
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  GenericTask(GenericTask&& other) noexcept
+      : h_(std::exchange(other.h_, nullptr)) {}
+  ~GenericTask() {
+    if (h_) h_.destroy();
+  }
+
+  T Get() && { return std::move(*h_.promise().value); }
+
+ private:
+  explicit GenericTask(std::coroutine_handle<promise_type> h) : h_(h) {}
+  std::coroutine_handle<promise_type> h_;
+};
+
+Task<StatusOr<int>> Parse(std::string s) {
+  MCO_VERIFY(!s.empty()).ErrorCode(StatusCode::kInvalidArgument) << "empty";
+  co_return static_cast<int>(s.size());
+}
+
+TEST(MCoVerify, Success) {
+  StatusOr<int> res = Parse("abc").Get();
+  ASSERT_TRUE(res.ok());
+  EXPECT_EQ(3, *res);
+}
+
+TEST(MCoVerify, Failure) {
+  StatusOr<int> res = Parse("").Get();
+  EXPECT_EQ(StatusCode::kInvalidArgument, res.status().code());
+  EXPECT_THAT(res.status().message(), HasSubstr("empty"));
+  EXPECT_THAT(res.status().message(), HasSubstr("MCO_VERIFY"));
+}
+
+TEST(MCoVerify, Relational) {
+  auto f = [](int n) -> Task<Status> {
+    MCO_VERIFY(n > 2);
+    co_return Status();
+  };
+  EXPECT_TRUE(f(3).Get().ok());
+  Status s = f(1).Get();
+  EXPECT_EQ(StatusCode::kUnknown, s.code());
+  EXPECT_THAT(s.message(), HasSubstr("n > 2"));
+}
+
+Task<StatusOr<int>> Twice(std::string s) {
+  StatusOr<int> parsed = co_await Parse(s);
+  int n = MCO_TRY(std::move(parsed));
+  co_return 2 * n;
+}
+
+TEST(MCoTry, Success) {
+  StatusOr<int> res = Twice("abc").Get();
+  ASSERT_TRUE(res.ok());
+  EXPECT_EQ(6, *res);
+}
+
+TEST(MCoTry, Failure) {
+  StatusOr<int> res = Twice("").Get();
+  EXPECT_EQ(StatusCode::kInvalidArgument, res.status().code());
+  EXPECT_THAT(res.status().message(), HasSubstr("empty"));
+}
+
+TEST(MCoTry, BuilderPatch) {
+  auto f = [](StatusOr<int> x) -> Task<StatusOr<int>> {
+    int n = MCO_TRY(x, _.ErrorCode(StatusCode::kInternal) << "patched");
+    co_return n + 1;
+  };
+  EXPECT_EQ(2, *f(1).Get());
+  StatusOr<int> res = f(Status(StatusCode::kNotFound, "nope")).Get();
+  EXPECT_EQ(StatusCode::kInternal, res.status().code());
+  EXPECT_THAT(res.status().message(), HasSubstr("patched"));
+}
+
+TEST(MCoVerify, Status) {
+  auto f = [](Status s) -> Task<Status> {
+    MCO_VERIFY(s);
+    co_return Status(StatusCode::kAborted, "reached");
+  };
+  EXPECT_EQ(StatusCode::kAborted, f(Status()).Get().code());
+  EXPECT_EQ(StatusCode::kNotFound,
+            f(Status(StatusCode::kNotFound, "")).Get().code());
+}
+
+TEST(MCoError, Unconditional) {
+  auto f = [](bool fail) -> Task<StatusOr<int>> {
+    if (fail) MCO_ERROR().ErrorCode(StatusCode::kNotFound) << "missing";
+    co_return 42;
+  };
+  EXPECT_EQ(42, *f(false).Get());
+  StatusOr<int> res = f(true).Get();
+  EXPECT_EQ(StatusCode::kNotFound, res.status().code());
+  EXPECT_THAT(res.status().message(), HasSubstr("missing"));
+}
+
+TEST(MCoVerify, ExplicitReturnType) {
+  auto f = [](int n) -> GenericTask<StatusOr<int>> {
+    MCO_VERIFY(n != 0).Return<StatusOr<int>>();
+    co_return n;
+  };
+  EXPECT_EQ(5, *f(5).Get());
+  EXPECT_FALSE(f(0).Get().ok());
+}
+
+}  // namespace
+}  // namespace merror
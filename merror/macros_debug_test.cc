@@ -0,0 +1,158 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Tests for `MDVERIFY()` and `MDTRY()`. The file is compiled twice: with
+// `MERROR_DEBUG_VERIFY` set to 1 (macros_debug_test) and with it set to 0
+// and optimizations on (macros_debug_opt_test).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gtest/gtest.h"
+#include "merror/domain/default.h"
+#include "merror/macros.h"
+
+#if defined(__linux__) && defined(__ELF__)
+#define MERROR_TEST_HAVE_SYMTAB 1
+#include <elf.h>
+#include <link.h>
+#endif
+
+namespace merror {
+namespace {
+
+using ::absl::Status;
+using ::absl::StatusCode;
+using ::absl::StatusOr;
+
+constexpr auto MErrorDomain = Default().DefaultErrorCode(StatusCode::kUnknown);
+
+int evaluated = 0;
+
+bool Positive(int n) {
+  ++evaluated;
+  return n > 0;
+}
+
+Status Verify(int n) {
+  MDVERIFY(Positive(n)).ErrorCode(StatusCode::kInvalidArgument) << "n=" << n;
+  return absl::OkStatus();
+}
+
+StatusOr<int> Try(StatusOr<int> x) { return MDTRY(x, _ << "Try") + 1; }
+
+TEST(MDVerify, Pass) {
+  evaluated = 0;
+  EXPECT_TRUE(Verify(1).ok());
+  EXPECT_EQ(MERROR_DEBUG_VERIFY, evaluated);
+}
+
+TEST(MDVerify, Fail) {
+  evaluated = 0;
+  Status s = Verify(0);
+  EXPECT_EQ(MERROR_DEBUG_VERIFY, evaluated);
+#if MERROR_DEBUG_VERIFY
+  EXPECT_EQ(StatusCode::kInvalidArgument, s.code());
+  EXPECT_NE(std::string::npos, s.message().find("MDVERIFY(Positive(n))"));
+  EXPECT_NE(std::string::npos, s.message().find("n=0"));
+#else
+  EXPECT_TRUE(s.ok());
+#endif
+}
+
+TEST(MDTry, Value) { EXPECT_EQ(2, *Try(1)); }
+
+#if MERROR_DEBUG_VERIFY
+TEST(MDTry, Error) {
+  Status s = Try(absl::NotFoundError("Missing")).status();
+  EXPECT_EQ(StatusCode::kNotFound, s.code());
+  EXPECT_NE(std::string::npos, s.message().find("Missing"));
+  EXPECT_NE(std::string::npos, s.message().find("Try"));
+}
+#else
+// With `MERROR_DEBUG_VERIFY` set to 0, `MDVERIFY()` must not leave a trace in
+// the generated code. Compare the machine code of two functions that differ
+// only in `MDVERIFY()`.
+__attribute__((noinline)) Status Plain(int* p, int n) {
+  *p = n + 1;
+  return absl::OkStatus();
+}
+
+__attribute__((noinline)) Status Checked(int* p, int n) {
+  MDVERIFY(p != nullptr);
+  MDVERIFY(n >= 0).ErrorCode(StatusCode::kOutOfRange) << "n=" << n;
+  *p = n + 1;
+  return absl::OkStatus();
+}
+
+#ifdef MERROR_TEST_HAVE_SYMTAB
+// Returns the size of the function at `fn` according to the symbol table of
+// the running binary, or zero if it isn't there.
+size_t FunctionSize(const void* fn) {
+  uintptr_t bias = 0;
+  dl_iterate_phdr(
+      [](dl_phdr_info* info, size_t, void* data) {
+        // The first object is the binary.
+        *static_cast<uintptr_t*>(data) = info->dlpi_addr;
+        return 1;
+      },
+      &bias);
+  std::ifstream file("/proc/self/exe", std::ios::binary);
+  std::string elf((std::istreambuf_iterator<char>(file)),
+                  std::istreambuf_iterator<char>());
+  if (elf.size() < sizeof(ElfW(Ehdr))) return 0;
+  const auto* eh = reinterpret_cast<const ElfW(Ehdr)*>(elf.data());
+  const auto* sections =
+      reinterpret_cast<const ElfW(Shdr)*>(elf.data() + eh->e_shoff);
+  for (size_t i = 0; i != eh->e_shnum; ++i) {
+    if (sections[i].sh_type != SHT_SYMTAB) continue;
+    const auto* syms =
+        reinterpret_cast<const ElfW(Sym)*>(elf.data() + sections[i].sh_offset);
+    size_t n = sections[i].sh_size / sizeof(ElfW(Sym));
+    for (size_t j = 0; j != n; ++j) {
+      if (ELF64_ST_TYPE(syms[j].st_info) == STT_FUNC &&
+          syms[j].st_value + bias == reinterpret_cast<uintptr_t>(fn)) {
+        return syms[j].st_size;
+      }
+    }
+  }
+  return 0;
+}
+#endif
+
+TEST(MDVerify, NoCode) {
+#if defined(MERROR_TEST_HAVE_SYMTAB) && defined(__OPTIMIZE__)
+  auto* plain = reinterpret_cast<const void*>(&Plain);
+  auto* checked = reinterpret_cast<const void*>(&Checked);
+  size_t size = FunctionSize(plain);
+  if (size == 0) GTEST_SKIP() << "The binary has no symbol table";
+  ASSERT_EQ(size, FunctionSize(checked));
+  // Both functions are tiny and don't contain calls, so their code is
+  // position-independent.
+  EXPECT_EQ(0, memcmp(plain, checked, size));
+#else
+  GTEST_SKIP() << "Requires an optimized ELF build";
+#endif
+}
+#endif
+
+}  // namespace
+}  // namespace merror
@@ -14,12 +14,15 @@
 //
 #include "merror/macros.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include <list>
 #include <memory>
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -58,6 +61,7 @@ struct ErrorContext {
   const char* args_str;
   Culprit culprit;
   optional<RelationalExpression> rel_expr;
+  std::ptrdiff_t index;
 };
 
 template <class Context>
@@ -75,7 +79,8 @@ struct ReflectingBuilder {
             ctx.macro_str,
             ctx.args_str,
             std::move(ctx.culprit),
-            ctx.rel_expr ? *ctx.rel_expr : optional<RelationalExpression>()};
+            ctx.rel_expr ? *ctx.rel_expr : optional<RelationalExpression>(),
+            ctx.index};
   }
 
   template <class T>
@@ -571,6 +576,257 @@ TEST(MVerify, UninitializedVariableWarning) {
   }();
 }
 
+struct RelExprBoolDomain : ReflectingDomain {
+  struct Acceptor {
+    bool IsError() { return !value; }
+    const bool& GetCulprit() && { return value; }
+    const bool& value;
+  };
+  Acceptor Verify(Ref<bool&&> val) const { return {val.Get()}; }
+  bool PrintOperands(int lhs, int rhs, std::string* lhs_str,
+                     std::string* rhs_str) const {
+    *lhs_str = std::to_string(lhs);
+    *rhs_str = std::to_string(rhs);
+    return true;
+  }
+};
+
+TEST(MVerifyAll, ControlFlow) {
+  using MErrorDomain = RelExprBoolDomain;
+  bool passed = false;
+  auto F = [&](bool a, bool b, bool c) -> Any {
+    passed = false;
+    MVERIFY_ALL(a, b, c);
+    passed = true;
+    return {};
+  };
+  F(true, true, true);
+  EXPECT_TRUE(passed);
+  F(false, true, true);
+  EXPECT_FALSE(passed);
+  F(true, true, false);
+  EXPECT_FALSE(passed);
+}
+
+TEST(MVerifyAll, EvaluatesAllConditionsOnce) {
+  using MErrorDomain = RelExprBoolDomain;
+  int evaluated[3] = {};
+  auto Cond = [&](int i) {
+    ++evaluated[i];
+    return true;
+  };
+  [&]() -> Any {
+    MVERIFY_ALL(Cond(0), Cond(1), Cond(2));
+    return {};
+  }();
+  EXPECT_THAT(evaluated, ::testing::ElementsAre(1, 1, 1));
+}
+
+TEST(MVerifyAll, Context) {
+  using MErrorDomain = RelExprBoolDomain;
+  const int line = __LINE__;
+  auto F = [](int a, int b, int c) {
+    MVERIFY_ALL(a >= 0, b < 10, c == 3);
+    static_cast<void>(1);
+  };
+  ErrorContext<bool> ctx = F(1, 42, 7);
+  EXPECT_THAT(ctx.macro, Macro::kVerify);
+  EXPECT_THAT(ctx.location_id, Not(0));
+  EXPECT_THAT(ctx.line, line + 2);
+  EXPECT_THAT(ctx.macro_str, StrEq("MVERIFY_ALL"));
+  // The first failed condition is reported.
+  EXPECT_THAT(ctx.args_str, StrEq("b < 10"));
+  EXPECT_FALSE(ctx.culprit);
+  ASSERT_TRUE(ctx.rel_expr);
+  EXPECT_EQ("42", ctx.rel_expr->left);
+  EXPECT_EQ("10", ctx.rel_expr->right);
+  EXPECT_EQ(RelationalOperator::kLt, ctx.rel_expr->op);
+}
+
+TEST(MVerifyAll, NonRelational) {
+  using MErrorDomain = RelExprBoolDomain;
+  auto F = [](bool a, bool b) {
+    MVERIFY_ALL(a, !b);
+    static_cast<void>(1);
+  };
+  ErrorContext<bool> ctx = F(true, true);
+  EXPECT_THAT(ctx.args_str, StrEq("!b"));
+  EXPECT_FALSE(ctx.rel_expr);
+}
+
+TEST(MVerifyAll, ManyConditions) {
+  using MErrorDomain = RelExprBoolDomain;
+  auto F = [](int n) {
+    MVERIFY_ALL(n != 0, n != 1, n != 2, n != 3, n != 4, n != 5, n != 6, n != 7,
+                n != 8, n != 9, n != 10, n != 11, n != 12, n != 13, n != 14,
+                n != 15, n != 16, n != 17, n != 18, n != 19, n != 20, n != 21,
+                n != 22, n != 23, n != 24, n != 25, n != 26, n != 27, n != 28,
+                n != 29, n != 30, n != 31);
+    static_cast<void>(1);
+  };
+  ErrorContext<bool> ctx = F(31);
+  EXPECT_THAT(ctx.args_str, StrEq("n != 31"));
+  ASSERT_TRUE(ctx.rel_expr);
+  EXPECT_EQ("31", ctx.rel_expr->left);
+}
+
+TEST(MVerifyAll, BuilderOperators) {
+  struct Builder {
+    int BuildError() { return error; }
+    int error;
+  };
+  struct Proxy {
+    Builder B() { return {42}; }
+  };
+  struct MErrorDomain {
+    struct Acceptor {
+      bool IsError() { return !value; }
+      bool GetCulprit() && { return false; }
+      bool value;
+    };
+    Acceptor Verify(Ref<bool&&> val) const { return {val.Get()}; }
+    Proxy GetErrorBuilder(Any) const { return {}; }
+  };
+  auto F = [&](bool b) {
+    MVERIFY_ALL(true, b).B();
+    return 0;
+  };
+  EXPECT_EQ(42, F(false));
+  EXPECT_EQ(0, F(true));
+}
+
+TEST(MVerifyAll, IfElse) {
+  using MErrorDomain = RelExprBoolDomain;
+  auto F = [&](bool val) -> Any {
+    if (val) MVERIFY_ALL(val, val);
+    if (val)
+      MVERIFY_ALL(val, val);
+    else
+      MVERIFY_ALL(!val, !val);
+    return {};
+  };
+  F(false);
+  F(true);
+}
+
+TEST(MVerifyEach, ControlFlow) {
+  using MErrorDomain = RelExprBoolDomain;
+  bool passed = false;
+  auto F = [&](const std::vector<int>& v) -> Any {
+    passed = false;
+    MVERIFY_EACH(v, _ > 0);
+    passed = true;
+    return {};
+  };
+  F({});
+  EXPECT_TRUE(passed);
+  F({1, 2, 3});
+  EXPECT_TRUE(passed);
+  F({1, 0, 3});
+  EXPECT_FALSE(passed);
+}
+
+TEST(MVerifyEach, Context) {
+  using MErrorDomain = RelExprBoolDomain;
+  const int line = __LINE__;
+  auto F = [](const std::vector<int>& v, int n) {
+    MVERIFY_EACH(v, _ < n);
+    static_cast<void>(1);
+  };
+  ErrorContext<bool> ctx = F({1, 2, 7, 9}, 5);
+  EXPECT_THAT(ctx.macro, Macro::kVerify);
+  EXPECT_THAT(ctx.location_id, Not(0));
+  EXPECT_THAT(ctx.line, line + 2);
+  EXPECT_THAT(ctx.macro_str, StrEq("MVERIFY_EACH"));
+  EXPECT_THAT(ctx.args_str, StrEq("v, _ < n"));
+  EXPECT_FALSE(ctx.culprit);
+  EXPECT_EQ(2, ctx.index);
+  ASSERT_TRUE(ctx.rel_expr);
+  EXPECT_EQ("7", ctx.rel_expr->left);
+  EXPECT_EQ("5", ctx.rel_expr->right);
+  EXPECT_EQ(RelationalOperator::kLt, ctx.rel_expr->op);
+}
+
+TEST(MVerifyEach, FirstFailureInEveryPosition) {
+  using MErrorDomain = RelExprBoolDomain;
+  auto F = [](const std::vector<int>& v) {
+    MVERIFY_EACH(v, _ != 0);
+    static_cast<void>(1);
+  };
+  // Covers several full blocks and a partial one.
+  for (int size : {1, 15, 16, 17, 50}) {
+    for (int i = 0; i != size; ++i) {
+      std::vector<int> v(size, 1);
+      v[i] = 0;
+      if (i + 1 < size) v[size - 1] = 0;
+      ErrorContext<bool> ctx = F(v);
+      EXPECT_EQ(i, ctx.index) << size;
+    }
+  }
+}
+
+TEST(MVerifyEach, NonRandomAccess) {
+  using MErrorDomain = RelExprBoolDomain;
+  auto F = [](const std::list<int>& v) {
+    MVERIFY_EACH(v, _ >= 0);
+    static_cast<void>(1);
+  };
+  ErrorContext<bool> ctx = F({3, 2, -1, -2});
+  EXPECT_EQ(2, ctx.index);
+  ASSERT_TRUE(ctx.rel_expr);
+  EXPECT_EQ("-1", ctx.rel_expr->left);
+}
+
+TEST(MVerifyEach, NonRelational) {
+  using MErrorDomain = RelExprBoolDomain;
+  auto F = [](const int (&v)[3]) {
+    MVERIFY_EACH(v, _ % 2 == 0 || _ == 1);
+    static_cast<void>(1);
+  };
+  ErrorContext<bool> ctx = F({2, 1, 3});
+  EXPECT_EQ(2, ctx.index);
+  EXPECT_THAT(ctx.args_str, StrEq("v, _ % 2 == 0 || _ == 1"));
+  EXPECT_FALSE(ctx.rel_expr);
+}
+
+TEST(MVerifyEach, EvaluatesRangeOnce) {
+  using MErrorDomain = RelExprBoolDomain;
+  int evaluated = 0;
+  auto Range = [&] {
+    ++evaluated;
+    return std::vector<int>(40, 1);
+  };
+  [&]() -> Any {
+    MVERIFY_EACH(Range(), _ == 1);
+    return {};
+  }();
+  EXPECT_EQ(1, evaluated);
+}
+
+TEST(MVerifyEach, IfElse) {
+  using MErrorDomain = RelExprBoolDomain;
+  std::vector<bool> v = {true};
+  auto F = [&](bool val) -> Any {
+    if (val) MVERIFY_EACH(v, _ == val);
+    if (val)
+      MVERIFY_EACH(v, _ == val);
+    else
+      MVERIFY_EACH(v, _ != val);
+    return {};
+  };
+  F(false);
+  F(true);
+}
+
+TEST(MVerify, NoIndex) {
+  using MErrorDomain = RelExprBoolDomain;
+  auto F = [](int n) {
+    MVERIFY(n > 0);
+    static_cast<void>(1);
+  };
+  EXPECT_EQ(-1, F(0).index);
+}
+
 struct VoidBuilder {
   void BuildError() const {}
 };
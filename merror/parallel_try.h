@@ -0,0 +1,215 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines `ParallelTry()`, which fans out independent calls to an executor and
+// stops at the first error, like Go's errgroup.
+//
+// `ParallelTry(executor, n, f)` calls `f(i, cancel)` for every `i` in
+// `[0, n)`. `f` must return `absl::StatusOr<T>` or `absl::Status`. If all calls
+// succeed, the result is `absl::StatusOr<std::vector<T>>` with the values in
+// index order (or OK if `f` returns `absl::Status`). Otherwise it's the first
+// error to be observed, and `cancel` is signaled: calls that haven't started
+// yet are skipped, and running calls may poll `cancel.cancelled()` to give up
+// early. Pass the result to `MTRY()` to build the error through the caller's
+// error domain, which applies descriptions, `Tee()`, logging, etc.
+//
+//   StatusOr<Profile> LoadProfile(ThreadPool& pool, const User& user) {
+//     constexpr MERROR_DOMAIN(merror::Default);
+//     std::vector<Shard> shards = MTRY(
+//         merror::ParallelTry(
+//             &pool, user.shards.size(),
+//             [&](size_t i, const merror::CancellationToken& cancel) {
+//               return ReadShard(user.shards[i], cancel);
+//             }),
+//         _ << "User: " << user.id);
+//     return MergeShards(shards);
+//   }
+//
+// An executor is any object with method `Post(std::function<void()> task)`,
+// such as `merror::ThreadPool` (see //merror/domain/async_tee.h). The calling
+// thread makes calls too, so `ParallelTry()` can't deadlock when the executor
+// is busy, drops tasks (`Post()` returns false) or runs the caller itself.
+// Tasks may outlive `ParallelTry()` but never call `f` after it returns; `f`
+// and the values may refer to the caller's locals.
+//
+// `ParallelTry()` returns when every call has either returned or been skipped.
+// Which of several concurrent errors is returned is unspecified.
+
+#ifndef MERROR_5EDA97_PARALLEL_TRY_H_
+#define MERROR_5EDA97_PARALLEL_TRY_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+namespace merror {
+
+// Set by `ParallelTry()` when one of the calls fails. See comments at the top
+// of the file.
+class CancellationToken {
+ public:
+  CancellationToken() = default;
+  CancellationToken(const CancellationToken&) = delete;
+  CancellationToken& operator=(const CancellationToken&) = delete;
+
+  void Cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+  bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<bool> cancelled_{false};
+};
+
+namespace internal_parallel_try {
+
+template <class R>
+struct Value;
+
+template <class T>
+struct Value<absl::StatusOr<T>> {
+  using type = T;
+};
+
+template <>
+struct Value<absl::Status> {
+  using type = void;
+};
+
+// Values of successful calls; nothing if `f` returns `absl::Status`.
+template <class T>
+struct Results {
+  explicit Results(size_t n) : values(n) {}
+  void Set(size_t i, absl::StatusOr<T>&& r) {
+    values[i].emplace(*std::move(r));
+  }
+  std::vector<std::optional<T>> values;
+};
+
+template <>
+struct Results<void> {
+  explicit Results(size_t) {}
+  void Set(size_t, absl::Status&&) {}
+};
+
+inline const absl::Status& GetStatus(const absl::Status& s) { return s; }
+
+template <class T>
+const absl::Status& GetStatus(const absl::StatusOr<T>& r) {
+  return r.status();
+}
+
+// State shared by the caller and the tasks. Tasks hold it by `shared_ptr`,
+// because a task may start after `ParallelTry()` has returned.
+template <class F, class T>
+class FanOut {
+ public:
+  FanOut(size_t n, F& f) : n_(n), f_(f), results_(n) {}
+
+  // Claims and makes calls until there are none left.
+  void Work() {
+    for (size_t i; (i = next_.fetch_add(1, std::memory_order_relaxed)) < n_;) {
+      if (!cancel_.cancelled()) {
+        auto r = f_(i, static_cast<const CancellationToken&>(cancel_));
+        if (GetStatus(r).ok()) {
+          results_.Set(i, std::move(r));
+        } else {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (error_.ok()) error_ = GetStatus(r);
+          }
+          // Calls that fail because of the cancellation don't mask the cause.
+          cancel_.Cancel();
+        }
+      }
+      if (done_.fetch_add(1, std::memory_order_acq_rel) + 1 == n_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_all();
+      }
+    }
+  }
+
+  // Blocks until every call has returned or been skipped.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock,
+             [this] { return done_.load(std::memory_order_acquire) == n_; });
+  }
+
+  absl::Status error() && { return std::move(error_); }
+  Results<T>& results() { return results_; }
+
+ private:
+  const size_t n_;
+  F& f_;
+  CancellationToken cancel_;
+  std::atomic<size_t> next_{0};
+  std::atomic<size_t> done_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  absl::Status error_;
+  Results<T> results_;
+};
+
+}  // namespace internal_parallel_try
+
+// Calls `f(i, cancel)` for every `i` in `[0, n)` on `executor` and the calling
+// thread. Returns all values or the first error. See comments at the top of
+// the file.
+template <class Executor, class F,
+          class R = std::invoke_result_t<F&, size_t, const CancellationToken&>,
+          class T = typename internal_parallel_try::Value<R>::type>
+std::conditional_t<std::is_void<T>::value, absl::Status,
+                   absl::StatusOr<std::vector<T>>>
+ParallelTry(Executor* executor, size_t n, F f) {
+  using FanOut = internal_parallel_try::FanOut<F, T>;
+  if (n == 0) {
+    if constexpr (std::is_void<T>::value) {
+      return absl::OkStatus();
+    } else {
+      return std::vector<T>();
+    }
+  }
+  auto state = std::make_shared<FanOut>(n, f);
+  for (size_t i = 1; i != n; ++i) {
+    executor->Post(std::function<void()>([state] { state->Work(); }));
+  }
+  state->Work();
+  state->Wait();
+  absl::Status error = std::move(*state).error();
+  if constexpr (std::is_void<T>::value) {
+    return error;
+  } else {
+    if (!error.ok()) return error;
+    std::vector<T> values;
+    values.reserve(n);
+    for (std::optional<T>& v : state->results().values) {
+      values.push_back(*std::move(v));
+    }
+    return values;
+  }
+}
+
+}  // namespace merror
+
+#endif  // MERROR_5EDA97_PARALLEL_TRY_H_
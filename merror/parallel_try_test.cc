@@ -0,0 +1,157 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "merror/parallel_try.h"
+
+#include <stddef.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "merror/domain/async_tee.h"
+#include "merror/domain/default.h"
+#include "merror/macros.h"
+
+namespace merror {
+namespace {
+
+using ::absl::Status;
+using ::absl::StatusCode;
+using ::absl::StatusOr;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+constexpr auto MErrorDomain = Default().DefaultErrorCode(StatusCode::kUnknown);
+
+// Executor that stores tasks until they are run explicitly.
+struct ManualExecutor {
+  void Post(std::function<void()> task) { tasks.push_back(std::move(task)); }
+  void RunAll() {
+    for (auto& task : tasks) task();
+    tasks.clear();
+  }
+  std::vector<std::function<void()>> tasks;
+};
+
+TEST(ParallelTry, Values) {
+  ThreadPool pool(4, 100);
+  StatusOr<std::vector<std::string>> res =
+      ParallelTry(&pool, 5, [](size_t i, const CancellationToken&) {
+        return StatusOr<std::string>(std::string(i, 'x'));
+      });
+  ASSERT_TRUE(res.ok());
+  EXPECT_THAT(*res, ElementsAre("", "x", "xx", "xxx", "xxxx"));
+}
+
+TEST(ParallelTry, Empty) {
+  ManualExecutor executor;
+  auto res = ParallelTry(&executor, 0, [](size_t, const CancellationToken&) {
+    return StatusOr<int>(1);
+  });
+  ASSERT_TRUE(res.ok());
+  EXPECT_TRUE(res->empty());
+  EXPECT_TRUE(executor.tasks.empty());
+}
+
+TEST(ParallelTry, MoveOnly) {
+  ThreadPool pool(2, 100);
+  auto res = ParallelTry(&pool, 3, [](size_t i, const CancellationToken&) {
+    return StatusOr<std::unique_ptr<size_t>>(std::make_unique<size_t>(i));
+  });
+  ASSERT_TRUE(res.ok());
+  ASSERT_EQ(3, res->size());
+  EXPECT_EQ(2, *(*res)[2]);
+}
+
+TEST(ParallelTry, SkipsCallsAfterError) {
+  // The tasks don't run until the end, so the caller makes all calls.
+  ManualExecutor executor;
+  std::vector<size_t> calls;
+  Status s = ParallelTry(&executor, 10,
+                         [&](size_t i, const CancellationToken& cancel) {
+                           EXPECT_FALSE(cancel.cancelled());
+                           calls.push_back(i);
+                           if (i == 3) return absl::NotFoundError("3");
+                           return absl::OkStatus();
+                         });
+  EXPECT_EQ(StatusCode::kNotFound, s.code());
+  EXPECT_THAT(calls, ElementsAre(0, 1, 2, 3));
+  // Tasks that start late don't make calls.
+  EXPECT_EQ(9, executor.tasks.size());
+  executor.RunAll();
+  EXPECT_THAT(calls, ElementsAre(0, 1, 2, 3));
+}
+
+TEST(ParallelTry, CancelsRunningCalls) {
+  ThreadPool pool(3, 100);
+  // Call 0 fails right away; the rest wait for the cancellation.
+  auto call = [](size_t i, const CancellationToken& cancel) -> StatusOr<int> {
+    if (i == 0) return absl::UnavailableError("Backend is down");
+    while (!cancel.cancelled()) std::this_thread::yield();
+    return absl::CancelledError("");
+  };
+  auto res = ParallelTry(&pool, 4, call);
+  EXPECT_EQ(StatusCode::kUnavailable, res.status().code());
+}
+
+TEST(ParallelTry, DroppedTasks) {
+  // The queue is full, so the caller makes all calls.
+  ThreadPool pool(1, 0);
+  std::atomic<int> calls{0};
+  Status s = ParallelTry(&pool, 8, [&](size_t, const CancellationToken&) {
+    ++calls;
+    return absl::OkStatus();
+  });
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(8, calls.load());
+  EXPECT_EQ(7, pool.dropped());
+}
+
+StatusOr<int> ReadShard(size_t i, int bad) {
+  MVERIFY(static_cast<int>(i) != bad).ErrorCode(StatusCode::kDataLoss)
+      << "Shard " << i;
+  return static_cast<int>(i);
+}
+
+TEST(ParallelTry, ThroughDomain) {
+  ThreadPool pool(2, 100);
+  std::vector<StatusCode> teed;
+  auto F = [&](int bad) -> StatusOr<int> {
+    const auto MErrorDomain = merror::MErrorDomain.Tee(
+        [&](const Status& s) { teed.push_back(s.code()); });
+    auto read = [&](size_t i, const CancellationToken&) {
+      return ReadShard(i, bad);
+    };
+    std::vector<int> v = MTRY(ParallelTry(&pool, 4, read), _ << "Fan-out");
+    return v[0] + v[1] + v[2] + v[3];
+  };
+  EXPECT_EQ(6, *F(-1));
+  EXPECT_TRUE(teed.empty());
+  Status s = F(2).status();
+  EXPECT_EQ(StatusCode::kDataLoss, s.code());
+  EXPECT_THAT(std::string(s.message()), HasSubstr("Shard 2"));
+  EXPECT_THAT(std::string(s.message()), HasSubstr("Fan-out"));
+  EXPECT_THAT(teed, ElementsAre(StatusCode::kDataLoss));
+}
+
+}  // namespace
+}  // namespace merror
@@ -0,0 +1,221 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Simulates a multi-threaded request handler to measure the end-to-end cost of
+// errors, including tail latency, which microbenchmarks don't show. Use it as a
+// regression gate for changes to the failure path.
+//
+// Every request goes through ten layers: the handler, eight layers that
+// validate their input with `MVERIFY()` and propagate errors from the layer
+// below with `MTRY()` and a description, and a storage read at the bottom,
+// which fails for a given fraction of requests. The handler logs every error
+// to an in-memory log guarded by a mutex, which stands in for `CerrLog()`.
+//
+// Arguments are the error rate in parts per thousand (0, 0.1%, 1%, 10% and
+// 50%) and the number of threads. Each iteration starts the threads, lets
+// each of them handle `kRequestsPerThread` requests and joins them. Reported:
+//
+//   * items_per_second: requests per second of wall time across all threads.
+//   * p50_ns, p99_ns, p999_ns: latency percentiles of individual requests
+//     across all iterations and threads. They include two clock reads.
+//   * error_rate: the fraction of requests that actually failed.
+//   * With MERROR_PERF_COUNTERS=1, hardware counters per request, including
+//     thread startup (see //merror/internal/perf_counters.h).
+//
+// Compare runs with benchmark's tools/compare.py:
+//
+//   $ bazel run -c opt //merror:service_benchmark -- \
+//       --benchmark_out=after.json --benchmark_repetitions=5
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+#include "merror/internal/perf_counters.h"
+#include "merror/merror.h"
+
+namespace merror {
+namespace {
+
+using ::absl::Status;
+using ::absl::StatusCode;
+using ::absl::StatusOr;
+
+constexpr int kRequestsPerThread = 2000;
+
+// Stand-in for a log file: a bounded buffer guarded by a mutex.
+class MemoryLog {
+ public:
+  void Append(const char* file, int line, std::string_view msg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (buf_.size() > kMaxSize) buf_.clear();
+    buf_ += file;
+    buf_ += ':';
+    buf_ += std::to_string(line);
+    buf_ += ": ";
+    buf_ += msg;
+    buf_ += '\n';
+  }
+
+ private:
+  static constexpr size_t kMaxSize = 1 << 20;
+  std::mutex mutex_;
+  std::string buf_;
+};
+
+MemoryLog& GetMemoryLog() {
+  static auto* log = new MemoryLog;
+  return *log;
+}
+
+struct MemoryLogger {
+  bool IsEnabled(const char* file, int line) const { return true; }
+  void Log(const char* file, int line, std::string_view msg) const {
+    GetMemoryLog().Append(file, line, msg);
+  }
+};
+
+constexpr auto MErrorDomain =
+    merror::Default().DefaultErrorCode(StatusCode::kUnknown);
+
+// The handler logs all errors that reach it.
+constexpr auto kHandlerDomain =
+    MErrorDomain.LogImpl<internal_logging::LogAndFilterAnnotation>(
+        MemoryLogger(), NoFilter());
+
+struct Request {
+  uint64_t id;
+  uint64_t key;
+  bool fail;
+};
+
+// A few nanoseconds of work per layer.
+uint64_t Mix(uint64_t x) {
+  x ^= x >> 31;
+  x *= 0x7fb5d329728ea185;
+  x ^= x >> 27;
+  return x;
+}
+
+StatusOr<uint64_t> ReadRow(const Request& req) {
+  MVERIFY(!req.fail).ErrorCode(StatusCode::kUnavailable)
+      << "Replica " << req.key % 3 << " is unavailable";
+  return Mix(req.key);
+}
+
+template <int N>
+StatusOr<uint64_t> Layer(const Request& req) {
+  if constexpr (N == 0) {
+    return ReadRow(req);
+  } else {
+    MVERIFY(req.key != 0).ErrorCode(StatusCode::kInvalidArgument);
+    uint64_t v = MTRY(Layer<N - 1>(req), _ << "Layer " << N);
+    return Mix(v + N);
+  }
+}
+
+Status Handle(const Request& req, uint64_t* res) {
+  constexpr auto MErrorDomain = kHandlerDomain;
+  *res = MTRY(Layer<8>(req), _ << "Request " << req.id << ", key " << req.key);
+  return absl::OkStatus();
+}
+
+// Handles `latencies.size()` requests, `error_rate` of which fail, and stores
+// the latency of each. Returns the number of failed requests.
+int Serve(uint64_t seed, double error_rate, std::vector<int64_t>& latencies) {
+  const uint64_t threshold =
+      static_cast<uint64_t>(error_rate * static_cast<double>(UINT64_MAX));
+  int errors = 0;
+  uint64_t sum = 0;
+  for (size_t i = 0; i != latencies.size(); ++i) {
+    seed = Mix(seed + 0x9e3779b97f4a7c15);
+    Request req{i, (seed | 1), error_rate > 0 && seed < threshold};
+    uint64_t res = 0;
+    auto start = std::chrono::steady_clock::now();
+    Status status = Handle(req, &res);
+    auto end = std::chrono::steady_clock::now();
+    benchmark::DoNotOptimize(status);
+    latencies[i] =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+            .count();
+    errors += !status.ok();
+    sum += res;
+  }
+  benchmark::DoNotOptimize(sum);
+  return errors;
+}
+
+void BM_Service(benchmark::State& state) {
+  const double error_rate = state.range(0) / 1000.0;
+  const int num_threads = state.range(1);
+  std::vector<std::vector<int64_t>> latencies(
+      num_threads, std::vector<int64_t>(kRequestsPerThread));
+  std::vector<int64_t> all;
+  int64_t errors = 0;
+  uint64_t seed = 0;
+  internal::PerfCounters perf;
+  for (auto _ : state) {
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<int64_t> iteration_errors{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t != num_threads; ++t) {
+      threads.emplace_back([&, t, seed = seed++] {
+        ready.fetch_add(1);
+        while (!go.load()) std::this_thread::yield();
+        iteration_errors.fetch_add(Serve(seed, error_rate, latencies[t]));
+      });
+    }
+    // Thread creation isn't part of the measurement.
+    while (ready.load() != num_threads) std::this_thread::yield();
+    auto start = std::chrono::steady_clock::now();
+    go.store(true);
+    for (std::thread& t : threads) t.join();
+    auto end = std::chrono::steady_clock::now();
+    state.SetIterationTime(
+        std::chrono::duration<double>(end - start).count());
+    errors += iteration_errors.load();
+    for (const auto& v : latencies) all.insert(all.end(), v.begin(), v.end());
+  }
+  perf.Report(state, int64_t{num_threads} * kRequestsPerThread);
+  if (all.empty()) return;
+  auto percentile = [&](double p) {
+    auto it = all.begin() + static_cast<size_t>(p * (all.size() - 1));
+    std::nth_element(all.begin(), it, all.end());
+    return static_cast<double>(*it);
+  };
+  state.counters["p50_ns"] = percentile(0.5);
+  state.counters["p99_ns"] = percentile(0.99);
+  state.counters["p999_ns"] = percentile(0.999);
+  state.counters["error_rate"] = static_cast<double>(errors) / all.size();
+  state.SetItemsProcessed(all.size());
+}
+BENCHMARK(BM_Service)
+    ->ArgsProduct({{0, 1, 10, 100, 500}, {1, 4, 16}})
+    ->ArgNames({"errors_per_1000", "threads"})
+    ->UseManualTime()
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace merror
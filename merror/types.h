@@ -17,6 +17,8 @@
 #ifndef MERROR_5EDA97_TYPES_H_
 #define MERROR_5EDA97_TYPES_H_
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <iosfwd>
 #include <string>
@@ -127,6 +129,43 @@ struct MErrorAccess;
 
 namespace internal {
 
+// The state of a site under the process-wide log budget. See `SetLogBudget()`
+// in //merror/domain/logging.h.
+struct LogSampling {
+  // The site logs one in 2^shift records that pass its log filter.
+  std::atomic<uint32_t> shift{0};
+  std::atomic<uint32_t> counter{0};
+  // Steady clock nanoseconds of the last change of `shift` and of the last
+  // record rejected by the budget. The rate changes at most once per second.
+  std::atomic<int64_t> adapted_at{0};
+  std::atomic<int64_t> rejected_at{0};
+  // Records dropped since the last summary by sampling and by the budget.
+  std::atomic<uint64_t> sampled_out{0};
+  std::atomic<uint64_t> rejected{0};
+  // Sites are registered on their first record under a budget.
+  std::atomic<bool> registered{false};
+  const char* file = nullptr;
+  int line = 0;
+  LogSampling* next = nullptr;
+};
+
+// The mutable state of a single macro expansion. `Context::location_id` is its
+// address.
+struct SiteState {
+  LogSampling log_sampling;
+  // The slot of the site in the error statistics table: the generation of the
+  // table in the high 32 bits and the slot index plus one in the low 32 bits.
+  // See //merror/domain/error_stats.h.
+  std::atomic<uint64_t> stats_slot{0};
+  // The slot of the site in the recent errors table, in the same format. See
+  // //merror/domain/recent_errors.h.
+  std::atomic<uint64_t> recent_errors_slot{0};
+};
+
+inline SiteState& GetSiteState(uintptr_t location_id) {
+  return *reinterpret_cast<SiteState*>(location_id);
+}
+
 template <Macro M, class Culprit>
 struct Context;
 
@@ -137,10 +176,11 @@ Context<M, Culprit&&> MakeContext(uintptr_t location_id, const char* function,
                                   const char* file, int line,
                                   const char* macro_str, const char* args_str,
                                   Culprit&& culprit,
-                                  RelationalExpression* rel_expr) {
+                                  RelationalExpression* rel_expr,
+                                  std::ptrdiff_t index = -1) {
   return Context<M, Culprit&&>(location_id, function, file, line, macro_str,
                                args_str, std::forward<Culprit>(culprit),
-                               rel_expr);
+                               rel_expr, index);
 }
 
 // Error context constructed by merror macros and passed to `GetErrorBuilder()`.
@@ -163,6 +203,9 @@ struct Context {
   //
   // Location ID isn't stable across binaries or even multiple runs of the same
   // binary.
+  //
+  // Internally, it's the address of the `SiteState` of the macro expansion. See
+  // `GetSiteState()`.
   uintptr_t location_id;
 
   // __PRETTY_FUNCTION__. Not null, not empty, infinite lifetime.
@@ -181,17 +224,21 @@ struct Context {
 
   Culprit&& culprit;
 
-  // In `Context<kMVerify>` with a relational expression (e.g., `x > 0`) and an
+  // In `Context<kVerify>` with a relational expression (e.g., `x > 0`) and an
   // error domain that supports expression stringification, `rel_expr` points to
   // a temporary object that gets destroyed after the macro is fully evaluated.
   // In all other cases rel_expr is null.
   RelationalExpression* rel_expr;
 
+  // In `Context<kVerify>` created by `MVERIFY_EACH()`, the index of the first
+  // range element that doesn't satisfy the predicate. In all other cases -1.
+  std::ptrdiff_t index;
+
  private:
   explicit Context(uintptr_t location_id, const char* function,
                    const char* file, int line, const char* macro_str,
                    const char* args_str, Culprit&& culprit,
-                   RelationalExpression* rel_expr)
+                   RelationalExpression* rel_expr, std::ptrdiff_t index)
       : location_id(location_id),
         function(function),
         file(file),
@@ -199,14 +246,16 @@ struct Context {
         macro_str(macro_str),
         args_str(args_str),
         culprit(std::forward<Culprit>(culprit)),
-        rel_expr(rel_expr) {}
+        rel_expr(rel_expr),
+        index(index) {}
 
   template <Macro X, class Y>
   friend Context<X, Y&&> MakeContext(uintptr_t location_id,
                                      const char* function, const char* file,
                                      int line, const char* macro_str,
                                      const char* args_str, Y&& culprit,
-                                     RelationalExpression* rel_expr);
+                                     RelationalExpression* rel_expr,
+                                     std::ptrdiff_t index);
 };
 
 template <Macro M, class Culprit>